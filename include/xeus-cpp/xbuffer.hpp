@@ -10,14 +10,144 @@
 #ifndef XEUS_CPP_BUFFER_HPP
 #define XEUS_CPP_BUFFER_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <streambuf>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "xeus_cpp_config.hpp"
+#include "xinterrupt.hpp"
 
 namespace xcpp
 {
+    /********************
+     * output publisher *
+     ********************/
+
+    /**
+     * Coalescing publisher shared by the output streams.
+     *
+     * Writers append records (stream, bytes) to a lock-free ring: a writer
+     * reserves space by advancing the head, copies its bytes, then commits
+     * them in reservation order, so that the output order across threads and
+     * streams is the order of the reservations. A background thread publishes
+     * the committed records every `interval`, or as soon as `threshold`
+     * bytes are pending, concatenating consecutive records of the same
+     * stream into a single message. The threshold is at most half of the
+     * ring, so that writers rarely wait for space. The thread is started
+     * by the first write, so that the publisher can be created before the
+     * zygote forks kernels.
+     */
+    class XEUS_CPP_API xoutput_publisher
+    {
+    public:
+
+        using callback_type = std::function<void(const std::string&)>;
+
+        xoutput_publisher(
+            std::chrono::milliseconds interval,
+            std::size_t threshold,
+            std::size_t capacity = std::size_t(1) << 20
+        );
+        ~xoutput_publisher();
+
+        xoutput_publisher(const xoutput_publisher&) = delete;
+        xoutput_publisher& operator=(const xoutput_publisher&) = delete;
+
+        // Streams must be registered before the first write.
+        std::size_t register_stream(callback_type callback);
+
+        void write(std::size_t stream, const char* s, std::size_t count);
+
+        // Publishes everything written so far, from the calling thread.
+        void flush();
+
+        // Publishes the pending output and stops the background thread,
+        // which the next write starts again. A forked process has no copy
+        // of the thread, which must be stopped before fork.
+        void stop();
+
+    private:
+
+        struct record_header
+        {
+            std::uint32_t size;
+            std::uint32_t stream;
+        };
+
+        std::uint64_t reserve(std::size_t size);
+        void commit(std::uint64_t start, std::size_t size);
+        void copy_in(std::uint64_t pos, const void* src, std::size_t count);
+        void copy_out(std::uint64_t pos, void* dst, std::size_t count) const;
+        void start();
+        void run();
+
+        std::chrono::milliseconds m_interval;
+        std::size_t m_threshold;
+        std::size_t m_capacity;
+        std::vector<char> m_ring;
+        std::vector<callback_type> m_callbacks;
+
+        std::atomic<std::uint64_t> m_head;
+        std::atomic<std::uint64_t> m_commit;
+        std::atomic<std::uint64_t> m_tail;
+
+        // Serializes the consumers, i.e. the background thread and flush.
+        std::mutex m_consumer_mutex;
+
+        std::mutex m_wake_mutex;
+        std::condition_variable m_wake;
+        bool m_stop;
+        std::atomic<bool> m_started;
+        std::thread m_thread;
+    };
+
+    /****************
+     * output limit *
+     ****************/
+
+    /**
+     * Per-cell budget of published output.
+     *
+     * Output past `limit` bytes is not published but appended to a file in
+     * the working directory, and reset() returns a notice pointing to it.
+     */
+    class XEUS_CPP_API xoutput_limit
+    {
+    public:
+
+        using callback_type = std::function<void(const std::string&)>;
+
+        explicit xoutput_limit(std::size_t limit);
+
+        // Publishes `output` with `callback` within the budget, and spills
+        // the rest.
+        void publish(const std::string& output, const callback_type& callback);
+
+        // Starts a new budget, returning the truncation notice of the
+        // previous one, or an empty string if nothing was spilled.
+        std::string reset();
+
+    private:
+
+        std::size_t m_limit;
+        std::size_t m_published;
+        std::size_t m_spilled;
+        std::string m_spill_path;
+        std::ofstream m_spill;
+        std::mutex m_mutex;
+    };
+
     /********************
      * output streambuf *
      ********************/
@@ -30,47 +160,140 @@ namespace xcpp
         using callback_type = std::function<void(const std::string&)>;
         using traits_type = base_type::traits_type;
 
+        // Pending output is published once it reaches this size, even if
+        // the stream is not flushed.
+        static constexpr std::size_t max_pending = 64 * 1024;
+
+        // Size of the put area used with a publisher, so that characters
+        // written one at a time make a single record.
+        static constexpr std::size_t put_area_size = 1024;
+
         xoutput_buffer(callback_type callback)
             : m_callback(std::move(callback))
         {
         }
 
+        // Routes the output to `publisher` instead of publishing it on each
+        // flush. Must be called before anything is written. The output is
+        // then collected in a put area until the stream is flushed or the
+        // area is full, so the stream must not be written by several threads
+        // at once, as for a buffered std::ofstream.
+        void set_publisher(xoutput_publisher* publisher)
+        {
+            p_publisher = publisher;
+            if (p_publisher != nullptr)
+            {
+                m_stream = p_publisher->register_stream(m_callback);
+                setp(m_put_area, m_put_area + put_area_size);
+            }
+            else
+            {
+                setp(nullptr, nullptr);
+            }
+        }
+
     protected:
 
         traits_type::int_type overflow(traits_type::int_type c) override
         {
+            // Called for each output character. An interrupt must not
+            // leave the buffer locked.
+            xinterrupt_shield shield;
+            if (traits_type::eq_int_type(c, traits_type::eof()))
+            {
+                return c;
+            }
+            if (p_publisher != nullptr)
+            {
+                // The put area is full.
+                drain();
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+                return c;
+            }
             std::lock_guard<std::mutex> lock(m_mutex);
-            // Called for each output character.
-            if (!traits_type::eq_int_type(c, traits_type::eof()))
+            m_output.push_back(traits_type::to_char_type(c));
+            if (m_output.size() >= max_pending)
             {
-                m_output.push_back(traits_type::to_char_type(c));
+                publish();
             }
             return c;
         }
 
         std::streamsize xsputn(const char* s, std::streamsize count) override
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
             // Called for a string of characters.
-            m_output.append(s, static_cast<std::size_t>(count));
+            xinterrupt_shield shield;
+            if (p_publisher != nullptr)
+            {
+                if (count <= epptr() - pptr())
+                {
+                    traits_type::copy(pptr(), s, static_cast<std::size_t>(count));
+                    pbump(static_cast<int>(count));
+                    return count;
+                }
+                drain();
+                p_publisher->write(m_stream, s, static_cast<std::size_t>(count));
+                return count;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::size_t remaining = static_cast<std::size_t>(count);
+            while (remaining > 0)
+            {
+                const std::size_t chunk = std::min(remaining, max_pending - m_output.size());
+                m_output.append(s, chunk);
+                s += chunk;
+                remaining -= chunk;
+                if (m_output.size() >= max_pending)
+                {
+                    publish();
+                }
+            }
             return count;
         }
 
         traits_type::int_type sync() override
         {
+            // Called in case of flush. With a publisher, the output is
+            // published by its own thread.
+            if (p_publisher != nullptr)
+            {
+                xinterrupt_shield shield;
+                drain();
+                return 0;
+            }
+            xinterrupt_shield shield;
             std::lock_guard<std::mutex> lock(m_mutex);
-            // Called in case of flush.
+            publish();
+            return 0;
+        }
+
+        // Hands the put area to the publisher.
+        void drain()
+        {
+            if (pptr() != pbase())
+            {
+                p_publisher->write(m_stream, pbase(), static_cast<std::size_t>(pptr() - pbase()));
+                setp(pbase(), epptr());
+            }
+        }
+
+        // Must be called with m_mutex held.
+        void publish()
+        {
             if (!m_output.empty())
             {
                 m_callback(m_output);
                 m_output.clear();
             }
-            return 0;
         }
 
         callback_type m_callback;
         std::string m_output;
         std::mutex m_mutex;
+        xoutput_publisher* p_publisher = nullptr;
+        std::size_t m_stream = 0;
+        char m_put_area[put_area_size];
     };
 
     /*******************
@@ -11,6 +11,7 @@
 #ifndef XEUS_CPP_INTERPRETER_HPP
 #define XEUS_CPP_INTERPRETER_HPP
 
+#include <chrono>
 #include <memory>
 #include <streambuf>
 #include <string>
@@ -30,6 +31,8 @@ namespace nl = nlohmann;
 
 namespace xcpp
 {
+    class xdoc_catalog;
+
     class XEUS_CPP_API interpreter : public xeus::xinterpreter
     {
     public:
@@ -40,6 +43,10 @@ namespace xcpp
         void publish_stdout(const std::string&);
         void publish_stderr(const std::string&);
 
+        // Stops the background threads of the interpreter, which start
+        // again when they are needed, so that the process can be forked.
+        void prepare_fork();
+
     private:
 
         void configure_impl() override;
@@ -70,21 +77,42 @@ namespace xcpp
 
         void redirect_output();
         void restore_output();
+        // Publishes the pending output of the cell.
+        void flush_output();
 
         void init_includes();
         void init_preamble();
         void init_magic();
 
         std::string m_version;
+        // Optimization level of the JIT, and whether it applies to all the
+        // cells or only to %%opt ones.
+        std::string m_opt_level;
+        bool m_optimize_cells = false;
+        // Clang arguments of the interpreter, used to compile the session
+        // ahead of time.
+        std::vector<std::string> m_compile_args;
+        // Whether the allocations of JIT compiled code can be tracked.
+        bool m_allocation_hooks = false;
+        // Time budget of the completion requests, 0 for none.
+        std::chrono::milliseconds m_complete_timeout{0};
 
         xmagics_manager xmagics;
         xpreamble_manager preamble_manager;
 
+        std::unique_ptr<xdoc_catalog> p_doc_catalog;
+
         std::streambuf* p_cout_strbuf;
         std::streambuf* p_cerr_strbuf;
 
         xoutput_buffer m_cout_buffer;
         xoutput_buffer m_cerr_buffer;
+
+        // Only set when the output of a cell is limited. Declared before
+        // the publisher, whose last flush goes through it.
+        std::unique_ptr<xoutput_limit> p_output_limit;
+        // Only set when the output is coalesced, see kernel_options.
+        std::unique_ptr<xoutput_publisher> p_output_publisher;
     };
 }
 
@@ -0,0 +1,80 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_INTERRUPT_HPP
+#define XEUS_CPP_INTERRUPT_HPP
+
+#include <functional>
+
+#include "xeus_cpp_config.hpp"
+
+namespace xcpp
+{
+    /**
+     * Interrupting the execution of a cell.
+     *
+     * Jupyter interrupts a kernel with SIGINT. Once install_interrupt_handler
+     * has been called, SIGINT aborts the function running in
+     * run_interruptible instead of terminating the kernel: the handler
+     * jumps back to run_interruptible, which returns SIGINT. The jump only
+     * happens while the interrupted thread runs JIT compiled code, i.e.
+     * code outside of any loaded object: in a library, such as libc,
+     * libstdc++ or the compiler, it may hold a lock or leave a data
+     * structure halfway. Otherwise the interrupt is retried until it lands
+     * in JIT compiled code, so a cell blocked in a library call is only
+     * interrupted once the call returns.
+     *
+     * Interrupts are only supported on POSIX systems, elsewhere SIGINT
+     * terminates the kernel.
+     */
+    XEUS_CPP_API void install_interrupt_handler();
+
+    /**
+     * Recovering from crashes of a cell.
+     *
+     * Once install_crash_handler has been called, SIGSEGV, SIGBUS, SIGFPE and
+     * SIGILL raised by JIT compiled code running in run_interruptible abort
+     * that code instead of the kernel. Stack overflows are caught on an
+     * alternate stack. Faults in libraries, e.g. in malloc after the cell
+     * corrupted the heap, leave the process in a state that cannot be
+     * trusted: they are passed to the handlers installed before, such as
+     * xcpp::handler.
+     */
+    XEUS_CPP_API void install_crash_handler();
+
+    // Runs `f` on the calling thread. Returns 0 if it completed, otherwise
+    // the signal that aborted it (SIGINT when interrupted).
+    XEUS_CPP_API int run_interruptible(const std::function<void()>& f);
+
+    XEUS_CPP_API void enter_interrupt_shield();
+    XEUS_CPP_API void leave_interrupt_shield();
+
+    /**
+     * Defers the interrupts of the calling thread while alive, for sections
+     * that must not be left halfway such as the ones holding a lock.
+     */
+    class xinterrupt_shield
+    {
+    public:
+
+        xinterrupt_shield()
+        {
+            enter_interrupt_shield();
+        }
+
+        ~xinterrupt_shield()
+        {
+            leave_interrupt_shield();
+        }
+
+        xinterrupt_shield(const xinterrupt_shield&) = delete;
+        xinterrupt_shield& operator=(const xinterrupt_shield&) = delete;
+    };
+}
+
+#endif
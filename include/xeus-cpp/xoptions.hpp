@@ -10,7 +10,9 @@
 #ifndef XEUS_CPP_OPTIONS_HPP
 #define XEUS_CPP_OPTIONS_HPP
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 #include <argparse/argparse.hpp>
 
@@ -26,5 +28,55 @@ namespace xcpp
         XEUS_CPP_API
         void parse(const std::string& line);
     };
+
+    /**
+     * Options of the kernel itself.
+     *
+     * They are given on the kernel command line (e.g. in the argv of a
+     * kernel.json) along with the Clang arguments, and are removed from the
+     * latter before they are forwarded to the interpreter.
+     */
+    struct kernel_options
+    {
+        // Headers included before the first cell, through a precompiled
+        // header when one can be built.
+        std::vector<std::string> prelude;
+        // Ignore the cached resource directory and system include paths.
+        bool rediscover_compiler_paths = false;
+        // Coalesce the output of the cells and publish it from a background
+        // thread every `output_flush_interval` milliseconds, or as soon as
+        // `output_flush_size` bytes are pending. The output is published on
+        // each flush when both are 0.
+        std::size_t output_flush_interval = 0;
+        std::size_t output_flush_size = 0;
+        // Bytes of output published per cell, the rest is written to a file
+        // in the working directory. 0 means unlimited.
+        std::size_t output_limit = 0;
+        // Optimization level of the cells ("0" to "3", "s" or "z"). Empty
+        // means the level of the -O flag of the Clang arguments, or 0.
+        std::string jit_opt_level;
+        // Run an optimizing pipeline even when the cells are not optimized,
+        // so that %%opt can optimize a single cell. Implied by an -O flag.
+        bool enable_opt_magic = false;
+        // Milliseconds a completion request waits for the candidates before
+        // answering with the ones at hand. 0 means no limit.
+        std::size_t complete_timeout = 0;
+    };
+
+    XEUS_CPP_API
+    kernel_options extract_kernel_options(std::vector<const char*>& args);
+
+    // Language standard selected by the -std= flags of the Clang arguments,
+    // as reported in language_info.version (e.g. "20" for -std=gnu++2a).
+    // Returns an empty string if the last flag does not select a known C++
+    // standard, e.g. for a C standard.
+    XEUS_CPP_API
+    std::string std_version_from_args(const std::vector<const char*>& args);
+
+    // Optimization level selected by the -O flags of the Clang arguments,
+    // e.g. "2" for -O2 and "1" for -O. Returns an empty string if there is
+    // no such flag.
+    XEUS_CPP_API
+    std::string opt_level_from_args(const std::vector<const char*>& args);
 }
 #endif
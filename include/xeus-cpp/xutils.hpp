@@ -29,6 +29,9 @@ namespace xcpp
 
     XEUS_CPP_API
     std::string retrieve_tagfile_dir();
+
+    XEUS_CPP_API
+    std::string retrieve_cache_dir();
 }
 
 #endif
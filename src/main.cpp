@@ -6,6 +6,7 @@
  * The full license is in the file LICENSE, distributed with this software. *
  ****************************************************************************/
 #include <cstddef>
+#include <cstdio>
 #include <memory>
 #include <string>
 #include <utility>
@@ -28,38 +29,18 @@
 
 #include "xeus-cpp/xeus_cpp_config.hpp"
 #include "xeus-cpp/xinterpreter.hpp"
+#include "xeus-cpp/xinterrupt.hpp"
 #include "xeus-cpp/xutils.hpp"
 
-int main(int argc, char* argv[])
-{
-    if (xeus::should_print_version(argc, argv))
-    {
-        std::clog << "xcpp " << XEUS_CPP_VERSION << std::endl;
-        return 0;
-    }
-
-    // If we are called from the Jupyter launcher, silence all logging. This
-    // is important for a JupyterHub configured with cleanup_servers = False:
-    // Upon restart, spawned single-user servers keep running but without the
-    // std* streams. When a user then tries to start a new kernel, xeus-cpp
-    // will get a SIGPIPE when writing to any of these and exit.
-    if (std::getenv("JPY_PARENT_PID") != NULL)
-    {
-        std::clog.setstate(std::ios_base::failbit);
-    }
+#include "xzygote.hpp"
 
-    // Registering SIGSEGV handler
-#ifdef __GNUC__
-    std::clog << "registering handler for SIGSEGV" << std::endl;
-    signal(SIGSEGV, xcpp::handler);
-
-    // Registering SIGINT and SIGKILL handlers
-    signal(SIGKILL, xcpp::stop_handler);
-#endif
-    signal(SIGINT, xcpp::stop_handler);
+static int start_kernel(std::unique_ptr<xcpp::interpreter> interpreter, const std::string& file_name)
+{
+    // From now on SIGINT interrupts the running cell instead of terminating
+    // the kernel, and a cell crashing in its own code is aborted.
+    xcpp::install_interrupt_handler();
+    xcpp::install_crash_handler();
 
-    std::string file_name = xeus::extract_filename(argc, argv);
-    auto interpreter = std::make_unique<xcpp::interpreter>(argc, argv);
     std::unique_ptr<xeus::xcontext> context = xeus::make_zmq_context();
 
     if (!file_name.empty())
@@ -143,3 +124,56 @@ int main(int argc, char* argv[])
 
     return 0;
 }
+
+int main(int argc, char* argv[])
+{
+    // Output captured from the file descriptors during a cell, e.g. by
+    // printf, then shows up line by line even though stdout is a pipe or a
+    // file. setvbuf must be called before anything is written to stdout.
+    std::setvbuf(stdout, nullptr, _IOLBF, BUFSIZ);
+
+    if (xeus::should_print_version(argc, argv))
+    {
+        std::clog << "xcpp " << XEUS_CPP_VERSION << std::endl;
+        return 0;
+    }
+
+    // If we are called from the Jupyter launcher, silence all logging. This
+    // is important for a JupyterHub configured with cleanup_servers = False:
+    // Upon restart, spawned single-user servers keep running but without the
+    // std* streams. When a user then tries to start a new kernel, xeus-cpp
+    // will get a SIGPIPE when writing to any of these and exit.
+    if (std::getenv("JPY_PARENT_PID") != NULL)
+    {
+        std::clog.setstate(std::ios_base::failbit);
+    }
+
+    // Registering SIGSEGV handler
+#ifdef __GNUC__
+    std::clog << "registering handler for SIGSEGV" << std::endl;
+    signal(SIGSEGV, xcpp::handler);
+
+    // Registering SIGINT and SIGKILL handlers
+    signal(SIGKILL, xcpp::stop_handler);
+#endif
+    signal(SIGINT, xcpp::stop_handler);
+
+    // Zygote mode: `--zygote <socket>` keeps an initialized interpreter and
+    // forks kernels from it, `--zygote-connect <socket>` is the kernel
+    // command line of a kernelspec served by a zygote.
+    std::string zygote_socket = xeus::extract_parameter("--zygote", argc, argv);
+    std::string zygote_connect = xeus::extract_parameter("--zygote-connect", argc, argv);
+
+    std::string file_name = xeus::extract_filename(argc, argv);
+    if (!zygote_connect.empty())
+    {
+        return xcpp::connect_zygote(zygote_connect, file_name);
+    }
+
+    auto interpreter = std::make_unique<xcpp::interpreter>(argc, argv);
+    if (!zygote_socket.empty())
+    {
+        return xcpp::run_zygote(zygote_socket, std::move(interpreter), start_kernel);
+    }
+    return start_kernel(std::move(interpreter), file_name);
+}
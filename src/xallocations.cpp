@@ -0,0 +1,314 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__linux__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+#include "clang/Interpreter/CppInterOp.h"
+
+#include "xallocations.hpp"
+
+namespace xcpp
+{
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+    namespace
+    {
+        std::atomic<bool> tracking(false);
+        std::mutex stats_mutex;
+        allocation_stats stats = {0, 0, 0, 0, 0, {}};
+        std::unordered_map<void*, std::pair<std::size_t, std::size_t>> sites;
+
+        std::size_t usable_size(void* p)
+        {
+#if defined(__linux__)
+            return malloc_usable_size(p);
+#elif defined(__APPLE__)
+            return malloc_size(p);
+#else
+            (void) p;
+            return 0;
+#endif
+        }
+
+        void count_allocation(void* p, std::size_t size, void* site)
+        {
+            if (p == nullptr || !tracking.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            const auto usable = static_cast<std::int64_t>(usable_size(p));
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            ++stats.allocations;
+            stats.bytes += size;
+            stats.live_bytes += usable;
+            if (stats.live_bytes > 0)
+            {
+                stats.peak_bytes = std::max(stats.peak_bytes, static_cast<std::size_t>(stats.live_bytes));
+            }
+            auto& s = sites[site];
+            ++s.first;
+            s.second += size;
+        }
+
+        void count_free(std::size_t usable)
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            ++stats.frees;
+            stats.live_bytes -= static_cast<std::int64_t>(usable);
+        }
+
+        void count_free(void* p)
+        {
+            if (p != nullptr && tracking.load(std::memory_order_relaxed))
+            {
+                count_free(usable_size(p));
+            }
+        }
+
+        // The return address of the hooks is the call site in JIT compiled
+        // code.
+#define XCPP_SITE __builtin_return_address(0)
+
+        void* hook_malloc(std::size_t size)
+        {
+            void* p = std::malloc(size);
+            count_allocation(p, size, XCPP_SITE);
+            return p;
+        }
+
+        void* hook_calloc(std::size_t count, std::size_t size)
+        {
+            void* p = std::calloc(count, size);
+            count_allocation(p, count * size, XCPP_SITE);
+            return p;
+        }
+
+        void* hook_realloc(void* old, std::size_t size)
+        {
+            const bool counted = old != nullptr && tracking.load(std::memory_order_relaxed);
+            const std::size_t old_usable = counted ? usable_size(old) : 0;
+            void* p = std::realloc(old, size);
+            if (counted && (p != nullptr || size == 0))
+            {
+                count_free(old_usable);
+            }
+            count_allocation(p, size, XCPP_SITE);
+            return p;
+        }
+
+        void* hook_aligned_alloc(std::size_t alignment, std::size_t size)
+        {
+            void* p = std::aligned_alloc(alignment, size);
+            count_allocation(p, size, XCPP_SITE);
+            return p;
+        }
+
+        void hook_free(void* p)
+        {
+            count_free(p);
+            std::free(p);
+        }
+
+        void* hook_new(std::size_t size)
+        {
+            void* p = ::operator new(size);
+            count_allocation(p, size, XCPP_SITE);
+            return p;
+        }
+
+        void* hook_new_array(std::size_t size)
+        {
+            void* p = ::operator new[](size);
+            count_allocation(p, size, XCPP_SITE);
+            return p;
+        }
+
+        void* hook_new_nothrow(std::size_t size, const std::nothrow_t& tag) noexcept
+        {
+            void* p = ::operator new(size, tag);
+            count_allocation(p, size, XCPP_SITE);
+            return p;
+        }
+
+        void* hook_new_array_nothrow(std::size_t size, const std::nothrow_t& tag) noexcept
+        {
+            void* p = ::operator new[](size, tag);
+            count_allocation(p, size, XCPP_SITE);
+            return p;
+        }
+
+        void* hook_new_aligned(std::size_t size, std::align_val_t alignment)
+        {
+            void* p = ::operator new(size, alignment);
+            count_allocation(p, size, XCPP_SITE);
+            return p;
+        }
+
+        void* hook_new_array_aligned(std::size_t size, std::align_val_t alignment)
+        {
+            void* p = ::operator new[](size, alignment);
+            count_allocation(p, size, XCPP_SITE);
+            return p;
+        }
+
+        void hook_delete(void* p) noexcept
+        {
+            count_free(p);
+            ::operator delete(p);
+        }
+
+        void hook_delete_array(void* p) noexcept
+        {
+            count_free(p);
+            ::operator delete[](p);
+        }
+
+        void hook_delete_sized(void* p, std::size_t size) noexcept
+        {
+            count_free(p);
+            ::operator delete(p, size);
+        }
+
+        void hook_delete_array_sized(void* p, std::size_t size) noexcept
+        {
+            count_free(p);
+            ::operator delete[](p, size);
+        }
+
+        void hook_delete_aligned(void* p, std::align_val_t alignment) noexcept
+        {
+            count_free(p);
+            ::operator delete(p, alignment);
+        }
+
+        void hook_delete_array_aligned(void* p, std::align_val_t alignment) noexcept
+        {
+            count_free(p);
+            ::operator delete[](p, alignment);
+        }
+
+        void hook_delete_sized_aligned(void* p, std::size_t size, std::align_val_t alignment) noexcept
+        {
+            count_free(p);
+            ::operator delete(p, size, alignment);
+        }
+
+        void hook_delete_array_sized_aligned(void* p, std::size_t size, std::align_val_t alignment) noexcept
+        {
+            count_free(p);
+            ::operator delete[](p, size, alignment);
+        }
+
+#undef XCPP_SITE
+
+        template <class F>
+        std::uint64_t address_of(F* f)
+        {
+            return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(f));
+        }
+    }
+
+    bool install_allocation_hooks()
+    {
+        // Itanium mangling of std::size_t.
+        const std::string s = sizeof(std::size_t) == sizeof(unsigned long) ? "m" : "j";
+        const std::pair<std::string, std::uint64_t> hooks[] = {
+            {"malloc", address_of(&hook_malloc)},
+            {"calloc", address_of(&hook_calloc)},
+            {"realloc", address_of(&hook_realloc)},
+            {"aligned_alloc", address_of(&hook_aligned_alloc)},
+            {"free", address_of(&hook_free)},
+            {"_Znw" + s, address_of(&hook_new)},
+            {"_Zna" + s, address_of(&hook_new_array)},
+            {"_Znw" + s + "RKSt9nothrow_t", address_of(&hook_new_nothrow)},
+            {"_Zna" + s + "RKSt9nothrow_t", address_of(&hook_new_array_nothrow)},
+            {"_Znw" + s + "St11align_val_t", address_of(&hook_new_aligned)},
+            {"_Zna" + s + "St11align_val_t", address_of(&hook_new_array_aligned)},
+            {"_ZdlPv", address_of(&hook_delete)},
+            {"_ZdaPv", address_of(&hook_delete_array)},
+            {"_ZdlPv" + s, address_of(&hook_delete_sized)},
+            {"_ZdaPv" + s, address_of(&hook_delete_array_sized)},
+            {"_ZdlPvSt11align_val_t", address_of(&hook_delete_aligned)},
+            {"_ZdaPvSt11align_val_t", address_of(&hook_delete_array_aligned)},
+            {"_ZdlPv" + s + "St11align_val_t", address_of(&hook_delete_sized_aligned)},
+            {"_ZdaPv" + s + "St11align_val_t", address_of(&hook_delete_array_sized_aligned)}
+        };
+
+        bool installed = true;
+        for (const auto& hook : hooks)
+        {
+#if defined(__APPLE__)
+            const std::string name = "_" + hook.first;
+#else
+            const std::string& name = hook.first;
+#endif
+            // Returns true on failure.
+            if (Cpp::InsertOrReplaceJitSymbol(name.c_str(), hook.second))
+            {
+                installed = false;
+            }
+        }
+        return installed;
+    }
+
+    void start_allocation_tracking()
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats = {0, 0, 0, 0, 0, {}};
+        sites.clear();
+        tracking.store(true);
+    }
+
+    allocation_stats stop_allocation_tracking()
+    {
+        tracking.store(false);
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        allocation_stats res = stats;
+        for (const auto& site : sites)
+        {
+            res.sites.push_back({site.first, site.second.first, site.second.second});
+        }
+        std::sort(
+            res.sites.begin(),
+            res.sites.end(),
+            [](const allocation_site& lhs, const allocation_site& rhs)
+            {
+                return lhs.bytes > rhs.bytes || (lhs.bytes == rhs.bytes && lhs.count > rhs.count);
+            }
+        );
+        sites.clear();
+        return res;
+    }
+#else
+    bool install_allocation_hooks()
+    {
+        return false;
+    }
+
+    void start_allocation_tracking()
+    {
+    }
+
+    allocation_stats stop_allocation_tracking()
+    {
+        return {0, 0, 0, 0, 0, {}};
+    }
+#endif
+}
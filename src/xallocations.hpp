@@ -0,0 +1,62 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_ALLOCATIONS_HPP
+#define XEUS_CPP_ALLOCATIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xeus-cpp/xeus_cpp_config.hpp"
+
+namespace xcpp
+{
+    // Allocations made from one call site.
+    struct allocation_site
+    {
+        // Return address of the allocation function.
+        void* address;
+        std::size_t count;
+        std::size_t bytes;
+    };
+
+    struct allocation_stats
+    {
+        std::size_t allocations;
+        std::size_t frees;
+        // Requested sizes.
+        std::size_t bytes;
+        // Highest amount of memory allocated and not freed since the start,
+        // measured with the usable sizes of the blocks.
+        std::size_t peak_bytes;
+        // Memory allocated and not freed at the end, negative when more was
+        // freed than allocated.
+        std::int64_t live_bytes;
+        std::vector<allocation_site> sites;
+    };
+
+    /**
+     * Tracking the allocations of JIT compiled code.
+     *
+     * install_allocation_hooks binds malloc, calloc, realloc, aligned_alloc,
+     * free and the replaceable operators new and delete in the JIT to
+     * wrappers, so that all the code compiled afterwards calls them. They
+     * forward to the actual functions, and count the allocations while the
+     * tracking is started. The allocations made inside precompiled libraries
+     * are not seen.
+     *
+     * Returns whether the hooks are installed.
+     */
+    XEUS_CPP_API bool install_allocation_hooks();
+
+    XEUS_CPP_API void start_allocation_tracking();
+    XEUS_CPP_API allocation_stats stop_allocation_tracking();
+}
+
+#endif
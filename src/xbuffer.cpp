@@ -0,0 +1,295 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xeus-cpp/xbuffer.hpp"
+
+namespace xcpp
+{
+    namespace
+    {
+        std::size_t round_up_pow2(std::size_t n)
+        {
+            std::size_t res = 1;
+            while (res < n)
+            {
+                res <<= 1;
+            }
+            return res;
+        }
+    }
+
+    xoutput_publisher::xoutput_publisher(
+        std::chrono::milliseconds interval,
+        std::size_t threshold,
+        std::size_t capacity
+    )
+        : m_interval(interval)
+        , m_threshold(threshold)
+        , m_capacity(round_up_pow2(std::max<std::size_t>(capacity, 4096)))
+        , m_ring(m_capacity)
+        , m_head(0)
+        , m_commit(0)
+        , m_tail(0)
+        , m_stop(false)
+        , m_started(false)
+    {
+        m_threshold = std::min(m_threshold, m_capacity / 2);
+    }
+
+    xoutput_publisher::~xoutput_publisher()
+    {
+        stop();
+        flush();
+    }
+
+    std::size_t xoutput_publisher::register_stream(callback_type callback)
+    {
+        std::lock_guard<std::mutex> lock(m_consumer_mutex);
+        m_callbacks.push_back(std::move(callback));
+        return m_callbacks.size() - 1;
+    }
+
+    void xoutput_publisher::write(std::size_t stream, const char* s, std::size_t count)
+    {
+        // A record left reserved but not committed would block the ring.
+        xinterrupt_shield shield;
+        if (!m_started.load(std::memory_order_acquire))
+        {
+            start();
+        }
+        // Large writes are split so that a record always fits in the ring
+        // along with the ones being published.
+        const std::size_t max_chunk = m_capacity / 4 - sizeof(record_header);
+        while (count > 0)
+        {
+            const std::size_t chunk = std::min(count, max_chunk);
+            record_header header = {static_cast<std::uint32_t>(chunk), static_cast<std::uint32_t>(stream)};
+            const std::size_t size = sizeof(header) + chunk;
+
+            std::uint64_t start = reserve(size);
+            copy_in(start, &header, sizeof(header));
+            copy_in(start + sizeof(header), s, chunk);
+            commit(start, size);
+
+            s += chunk;
+            count -= chunk;
+        }
+
+        if (m_commit.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_relaxed) >= m_threshold)
+        {
+            m_wake.notify_one();
+        }
+    }
+
+    void xoutput_publisher::flush()
+    {
+        std::vector<std::pair<std::size_t, std::string>> runs;
+        std::lock_guard<std::mutex> lock(m_consumer_mutex);
+
+        std::uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        const std::uint64_t end = m_commit.load(std::memory_order_acquire);
+        while (tail < end)
+        {
+            record_header header;
+            copy_out(tail, &header, sizeof(header));
+            tail += sizeof(header);
+            if (runs.empty() || runs.back().first != header.stream)
+            {
+                runs.emplace_back(header.stream, std::string());
+            }
+            std::string& output = runs.back().second;
+            const std::size_t offset = output.size();
+            output.resize(offset + header.size);
+            copy_out(tail, &output[offset], header.size);
+            tail += header.size;
+        }
+        // Release the space before publishing, which may be slow.
+        m_tail.store(tail, std::memory_order_release);
+
+        for (const auto& run : runs)
+        {
+            m_callbacks[run.first](run.second);
+        }
+    }
+
+    void xoutput_publisher::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_wake_mutex);
+            if (!m_started.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_stop = false;
+        m_started.store(false, std::memory_order_release);
+    }
+
+    void xoutput_publisher::start()
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        if (!m_started.load(std::memory_order_relaxed))
+        {
+            m_thread = std::thread(&xoutput_publisher::run, this);
+            m_started.store(true, std::memory_order_release);
+        }
+    }
+
+    std::uint64_t xoutput_publisher::reserve(std::size_t size)
+    {
+        std::uint64_t head = m_head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            if (head + size - m_tail.load(std::memory_order_acquire) > m_capacity)
+            {
+                // The ring is full, wait for the publisher thread.
+                m_wake.notify_one();
+                std::this_thread::yield();
+                head = m_head.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (m_head.compare_exchange_weak(head, head + size, std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                return head;
+            }
+        }
+    }
+
+    void xoutput_publisher::commit(std::uint64_t start, std::size_t size)
+    {
+        // Commits happen in reservation order, so that everything below
+        // m_commit is readable.
+        while (m_commit.load(std::memory_order_acquire) != start)
+        {
+            std::this_thread::yield();
+        }
+        m_commit.store(start + size, std::memory_order_release);
+    }
+
+    void xoutput_publisher::copy_in(std::uint64_t pos, const void* src, std::size_t count)
+    {
+        const std::size_t offset = static_cast<std::size_t>(pos & (m_capacity - 1));
+        const std::size_t first = std::min(count, m_capacity - offset);
+        const char* bytes = static_cast<const char*>(src);
+        std::memcpy(m_ring.data() + offset, bytes, first);
+        std::memcpy(m_ring.data(), bytes + first, count - first);
+    }
+
+    void xoutput_publisher::copy_out(std::uint64_t pos, void* dst, std::size_t count) const
+    {
+        const std::size_t offset = static_cast<std::size_t>(pos & (m_capacity - 1));
+        const std::size_t first = std::min(count, m_capacity - offset);
+        char* bytes = static_cast<char*>(dst);
+        std::memcpy(bytes, m_ring.data() + offset, first);
+        std::memcpy(bytes + first, m_ring.data(), count - first);
+    }
+
+    void xoutput_publisher::run()
+    {
+        std::unique_lock<std::mutex> lock(m_wake_mutex);
+        while (!m_stop)
+        {
+            // Writers only notify when the threshold is reached, a missed
+            // notification delays the output by at most one interval.
+            m_wake.wait_for(
+                lock,
+                m_interval,
+                [this]()
+                {
+                    return m_stop
+                           || m_commit.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_relaxed)
+                                  >= m_threshold;
+                }
+            );
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+        lock.unlock();
+        flush();
+    }
+
+    xoutput_limit::xoutput_limit(std::size_t limit)
+        : m_limit(limit)
+        , m_published(0)
+        , m_spilled(0)
+    {
+    }
+
+    void xoutput_limit::publish(const std::string& output, const callback_type& callback)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const std::size_t available = m_limit - std::min(m_published, m_limit);
+        if (output.size() <= available)
+        {
+            m_published += output.size();
+            callback(output);
+            return;
+        }
+
+        if (available > 0)
+        {
+            m_published += available;
+            callback(output.substr(0, available));
+        }
+
+        if (m_spilled == 0)
+        {
+            static std::atomic<unsigned> counter(0);
+            const auto stamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            );
+            std::error_code ec;
+            std::filesystem::path path = std::filesystem::absolute(
+                "xcpp-output-" + std::to_string(stamp.count()) + "-" + std::to_string(counter++) + ".log",
+                ec
+            );
+            m_spill_path = path.string();
+            m_spill.open(m_spill_path, std::ios::binary);
+        }
+        m_spill.write(output.data() + available, static_cast<std::streamsize>(output.size() - available));
+        m_spilled += output.size() - available;
+    }
+
+    std::string xoutput_limit::reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::string notice;
+        if (m_spilled > 0)
+        {
+            notice = "\n[Output truncated after " + std::to_string(m_published) + " bytes: ";
+            if (m_spill.good())
+            {
+                notice += std::to_string(m_spilled) + " more bytes were written to " + m_spill_path + "]\n";
+            }
+            else
+            {
+                notice += std::to_string(m_spilled) + " more bytes were discarded, " + m_spill_path
+                          + " could not be written]\n";
+            }
+            m_spill.close();
+            m_spill.clear();
+        }
+        m_published = 0;
+        m_spilled = 0;
+        m_spill_path.clear();
+        return notice;
+    }
+}
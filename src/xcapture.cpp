@@ -0,0 +1,218 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "xcapture.hpp"
+
+namespace xcpp
+{
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+    namespace
+    {
+        void set_flags(int fd)
+        {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+
+    xfd_capture::xfd_capture(std::streambuf* out, std::streambuf* err, std::size_t max_captured_stderr)
+        : m_max_stderr(max_captured_stderr)
+        , m_active(false)
+    {
+        // The buffering of stdout is left as it is, setvbuf is only valid
+        // before the first output. xcpp makes it line buffered at startup.
+        std::fflush(stdout);
+        std::fflush(stderr);
+
+        m_channels[0].fd = STDOUT_FILENO;
+        m_channels[0].target = out;
+        m_channels[1].fd = STDERR_FILENO;
+        m_channels[1].target = err;
+
+        if (::pipe(m_wake) != 0)
+        {
+            m_wake[0] = m_wake[1] = -1;
+            return;
+        }
+        for (channel& c : m_channels)
+        {
+            int fds[2];
+            if (::pipe(fds) != 0)
+            {
+                stop();
+                return;
+            }
+            c.saved = ::dup(c.fd);
+            ::dup2(fds[1], c.fd);
+            ::close(fds[1]);
+            c.read_end = fds[0];
+            set_flags(c.read_end);
+            ::fcntl(c.saved, F_SETFD, FD_CLOEXEC);
+        }
+        set_flags(m_wake[0]);
+
+        m_active = true;
+        m_reader = std::thread(&xfd_capture::run, this);
+    }
+
+    xfd_capture::~xfd_capture()
+    {
+        stop();
+    }
+
+    void xfd_capture::stop()
+    {
+        std::fflush(stdout);
+        std::fflush(stderr);
+        for (channel& c : m_channels)
+        {
+            if (c.saved >= 0)
+            {
+                ::dup2(c.saved, c.fd);
+                ::close(c.saved);
+                c.saved = -1;
+            }
+        }
+
+        if (m_active)
+        {
+            // Processes started by the cell may still hold the pipes, so the
+            // reader is told to stop once the pipes are empty rather than
+            // waiting for them to be closed.
+            char byte = 0;
+            while (::write(m_wake[1], &byte, 1) < 0 && errno == EINTR)
+            {
+            }
+            m_reader.join();
+            m_active = false;
+        }
+
+        for (channel& c : m_channels)
+        {
+            if (c.read_end >= 0)
+            {
+                ::close(c.read_end);
+                c.read_end = -1;
+            }
+        }
+        for (int& fd : m_wake)
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    }
+
+    const std::string& xfd_capture::captured_stderr() const
+    {
+        return m_stderr;
+    }
+
+    void xfd_capture::run()
+    {
+        std::vector<char> buffer(64 * 1024);
+        bool open[2] = {true, true};
+        while (open[0] || open[1])
+        {
+            pollfd fds[3] = {
+                {open[0] ? m_channels[0].read_end : -1, POLLIN, 0},
+                {open[1] ? m_channels[1].read_end : -1, POLLIN, 0},
+                {m_wake[0], POLLIN, 0}
+            };
+            if (::poll(fds, 3, -1) < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                break;
+            }
+            for (std::size_t i = 0; i < 2; ++i)
+            {
+                if (open[i] && fds[i].revents != 0)
+                {
+                    open[i] = drain(m_channels[i], buffer.data(), buffer.size());
+                }
+            }
+            if (fds[2].revents != 0)
+            {
+                for (std::size_t i = 0; i < 2; ++i)
+                {
+                    if (open[i])
+                    {
+                        drain(m_channels[i], buffer.data(), buffer.size());
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    bool xfd_capture::drain(channel& c, char* buffer, std::size_t size)
+    {
+        while (true)
+        {
+            ssize_t n = ::read(c.read_end, buffer, size);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            if (n == 0)
+            {
+                return false;
+            }
+            const std::size_t count = static_cast<std::size_t>(n);
+            if (c.fd == STDERR_FILENO && m_stderr.size() < m_max_stderr)
+            {
+                m_stderr.append(buffer, std::min(count, m_max_stderr - m_stderr.size()));
+            }
+            if (c.target != nullptr)
+            {
+                c.target->sputn(buffer, static_cast<std::streamsize>(count));
+                c.target->pubsync();
+            }
+        }
+    }
+#else
+    xfd_capture::xfd_capture(std::streambuf*, std::streambuf*, std::size_t max_captured_stderr)
+        : m_max_stderr(max_captured_stderr)
+        , m_active(false)
+    {
+    }
+
+    xfd_capture::~xfd_capture()
+    {
+    }
+
+    void xfd_capture::stop()
+    {
+    }
+
+    const std::string& xfd_capture::captured_stderr() const
+    {
+        return m_stderr;
+    }
+#endif
+}
@@ -0,0 +1,73 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_CAPTURE_HPP
+#define XEUS_CPP_CAPTURE_HPP
+
+#include <cstddef>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#include "xeus-cpp/xeus_cpp_config.hpp"
+
+namespace xcpp
+{
+    /**
+     * Captures the standard output and error file descriptors.
+     *
+     * While alive, file descriptors 1 and 2 are redirected to pipes drained
+     * by a reader thread, which forwards the output to `out` and `err` as
+     * it arrives. This covers everything written below the C++ streams, such
+     * as printf, C libraries and the diagnostics of the interpreter. The
+     * beginning of the error output is also kept, to report compilation
+     * errors. Output buffered by stdio is flushed when the capture starts
+     * and stops, but its buffering is not changed: printf only shows up
+     * during the cell if stdout is line buffered, as xcpp makes it.
+     *
+     * Only available on POSIX systems.
+     */
+    class XEUS_CPP_API xfd_capture
+    {
+    public:
+
+        xfd_capture(std::streambuf* out, std::streambuf* err, std::size_t max_captured_stderr = 64 * 1024);
+        ~xfd_capture();
+
+        xfd_capture(const xfd_capture&) = delete;
+        xfd_capture& operator=(const xfd_capture&) = delete;
+
+        // Restores the file descriptors and waits for the output written so
+        // far to be forwarded.
+        void stop();
+
+        const std::string& captured_stderr() const;
+
+    private:
+
+        struct channel
+        {
+            int fd = -1;
+            int saved = -1;
+            int read_end = -1;
+            std::streambuf* target = nullptr;
+        };
+
+        void run();
+        bool drain(channel& c, char* buffer, std::size_t size);
+
+        channel m_channels[2];
+        int m_wake[2] = {-1, -1};
+        std::string m_stderr;
+        std::size_t m_max_stderr;
+        std::thread m_reader;
+        bool m_active;
+    };
+}
+
+#endif
@@ -0,0 +1,463 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#endif
+
+#include <nlohmann/json.hpp>
+
+#include "clang/Interpreter/CppInterOp.h"
+
+#include "xcompiler.hpp"
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    namespace
+    {
+#if defined(_WIN32)
+        constexpr char path_separator = ';';
+        constexpr const char* executable_suffix = ".exe";
+#else
+        constexpr char path_separator = ':';
+        constexpr const char* executable_suffix = "";
+#endif
+
+        bool is_executable(const fs::path& path)
+        {
+            std::error_code ec;
+            if (!fs::is_regular_file(path, ec))
+            {
+                return false;
+            }
+#if defined(_WIN32)
+            return true;
+#else
+            auto perms = fs::status(path, ec).permissions();
+            return !ec && (perms & fs::perms::others_exec) != fs::perms::none;
+#endif
+        }
+
+        struct fnv_hash
+        {
+            std::uint64_t value = 14695981039346656037ULL;
+
+            void mix(const std::string& s)
+            {
+                for (char c : s)
+                {
+                    value ^= static_cast<unsigned char>(c);
+                    value *= 1099511628211ULL;
+                }
+                // Separator, so that consecutive strings cannot be confused.
+                value ^= 0x1f;
+                value *= 1099511628211ULL;
+            }
+
+            std::string hex() const
+            {
+                const char* digits = "0123456789abcdef";
+                std::string res(16, '0');
+                for (std::size_t i = 0; i < 16; ++i)
+                {
+                    res[15 - i] = digits[(value >> (4 * i)) & 0xf];
+                }
+                return res;
+            }
+        };
+
+        std::string mtime_string(const fs::path& path)
+        {
+            std::error_code ec;
+            auto time = fs::last_write_time(path, ec);
+            if (ec)
+            {
+                return "";
+            }
+            return std::to_string(time.time_since_epoch().count());
+        }
+
+        // Arguments of the interpreter that must not be forwarded to the
+        // driver building the PCH.
+        bool skip_pch_argument(const char* arg)
+        {
+            return std::strcmp(arg, "-v") == 0 || std::strncmp(arg, "-x", 2) == 0;
+        }
+
+        bool is_c_mode(const std::vector<const char*>& args)
+        {
+            for (std::size_t i = 0; i < args.size(); ++i)
+            {
+                if (std::strcmp(args[i], "-xc") == 0
+                    || (std::strcmp(args[i], "-x") == 0 && i + 1 < args.size() && std::strcmp(args[i + 1], "c") == 0))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    compiler_paths detect_compiler_paths(const std::string& cache_dir, bool rediscover, bool detect_resource_dir)
+    {
+        // The compilers run by CppInterOp's detection functions.
+        std::string key;
+        for (const char* name : {"clang", "c++"})
+        {
+            std::string program = find_program(name);
+            if (program.empty())
+            {
+                key.clear();
+                break;
+            }
+            std::error_code ec;
+            fs::path resolved = fs::canonical(program, ec);
+            if (ec)
+            {
+                resolved = program;
+            }
+            key += resolved.string() + "@" + mtime_string(resolved) + ";";
+        }
+
+        const fs::path cache_file = fs::path(cache_dir) / "compiler_paths.json";
+        nl::json cache = nl::json::object();
+        if (!key.empty() && !cache_dir.empty())
+        {
+            std::ifstream in(cache_file);
+            if (in)
+            {
+                try
+                {
+                    cache = nl::json::parse(in);
+                }
+                catch (const std::exception&)
+                {
+                    cache = nl::json::object();
+                }
+            }
+            if (!cache.is_object())
+            {
+                cache = nl::json::object();
+            }
+            if (!rediscover && cache.contains(key))
+            {
+                const nl::json& entry = cache[key];
+                try
+                {
+                    compiler_paths res;
+                    res.resource_dir = entry.at("resource_dir").get<std::string>();
+                    res.system_includes = entry.at("system_includes").get<std::vector<std::string>>();
+                    // Entries written without the resource directory only
+                    // serve the launches that do not need it.
+                    if (!res.resource_dir.empty() || !detect_resource_dir)
+                    {
+                        return res;
+                    }
+                }
+                catch (const std::exception&)
+                {
+                    // Malformed entry, detect again.
+                }
+            }
+        }
+
+        compiler_paths res;
+        if (detect_resource_dir)
+        {
+            res.resource_dir = Cpp::DetectResourceDir();
+        }
+        Cpp::DetectSystemCompilerIncludePaths(res.system_includes);
+
+        // A failed detection is not cached, so that installing a toolchain
+        // does not require a rediscovery.
+        if (key.empty() || cache_dir.empty() || (detect_resource_dir && res.resource_dir.empty()))
+        {
+            return res;
+        }
+
+        cache[key] = {{"resource_dir", res.resource_dir}, {"system_includes", res.system_includes}};
+        std::error_code ec;
+        fs::create_directories(cache_file.parent_path(), ec);
+        const std::string tmp_file = cache_file.string() + "."
+                                     + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        {
+            std::ofstream out(tmp_file);
+            out << cache.dump(2);
+            if (!out)
+            {
+                out.close();
+                fs::remove(tmp_file, ec);
+                return res;
+            }
+        }
+        fs::rename(tmp_file, cache_file, ec);
+        if (ec)
+        {
+            fs::remove(tmp_file, ec);
+        }
+        return res;
+    }
+
+    std::string find_program(const std::string& name)
+    {
+        const char* path_env = std::getenv("PATH");
+        if (path_env == nullptr)
+        {
+            return "";
+        }
+        std::stringstream paths(path_env);
+        std::string dir;
+        while (std::getline(paths, dir, path_separator))
+        {
+            if (dir.empty())
+            {
+                continue;
+            }
+            fs::path candidate = fs::path(dir) / (name + executable_suffix);
+            if (is_executable(candidate))
+            {
+                return candidate.string();
+            }
+        }
+        return "";
+    }
+
+    std::string find_clang(const std::string& resource_dir, bool cxx)
+    {
+        const std::string name = cxx ? "clang++" : "clang";
+        std::string version;
+        if (!resource_dir.empty())
+        {
+            fs::path resource(resource_dir);
+            fs::path candidate = resource.parent_path().parent_path().parent_path() / "bin"
+                                 / (name + executable_suffix);
+            if (is_executable(candidate))
+            {
+                return candidate.string();
+            }
+            // Distributions install versioned drivers, e.g. clang++-17 for
+            // the resource directory lib/clang/17.
+            version = resource.filename().string();
+            version = version.substr(0, version.find('.'));
+        }
+        if (!version.empty())
+        {
+            std::string versioned = find_program(name + "-" + version);
+            if (!versioned.empty())
+            {
+                return versioned;
+            }
+        }
+        return find_program(name);
+    }
+
+    std::string shell_quote(const std::string& arg)
+    {
+#if defined(_WIN32)
+        std::string res = "\"";
+        for (char c : arg)
+        {
+            if (c == '"')
+            {
+                res += '\\';
+            }
+            res += c;
+        }
+        return res + "\"";
+#else
+        std::string res = "'";
+        for (char c : arg)
+        {
+            if (c == '\'')
+            {
+                res += "'\\''";
+            }
+            else
+            {
+                res += c;
+            }
+        }
+        return res + "'";
+#endif
+    }
+
+    int run_command(const std::string& command, std::string& output)
+    {
+        output.clear();
+#if defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        (void) command;
+        return -1;
+#else
+        std::string redirected = command + " 2>&1";
+#if defined(_WIN32)
+        FILE* pipe = _popen(redirected.c_str(), "r");
+#else
+        FILE* pipe = popen(redirected.c_str(), "r");
+#endif
+        if (pipe == nullptr)
+        {
+            return -1;
+        }
+        char buffer[4096];
+        std::size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+        {
+            output.append(buffer, n);
+        }
+#if defined(_WIN32)
+        return _pclose(pipe);
+#else
+        int status = pclose(pipe);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+#endif
+    }
+
+    std::string host_cpu_name(const std::string& resource_dir)
+    {
+        std::string clang = find_clang(resource_dir);
+        if (clang.empty())
+        {
+            return "";
+        }
+#if defined(_WIN32)
+        const char* null_device = "NUL";
+#else
+        const char* null_device = "/dev/null";
+#endif
+        // -### prints the frontend invocation, with the resolved CPU, without
+        // running it.
+        std::string output;
+        std::string command = shell_quote(clang) + " -march=native -### -x c++ -c " + null_device;
+        if (run_command(command, output) != 0)
+        {
+            return "";
+        }
+        const std::string flag = "\"-target-cpu\" \"";
+        std::size_t begin = output.find(flag);
+        if (begin == std::string::npos)
+        {
+            return "";
+        }
+        begin += flag.size();
+        std::size_t end = output.find('"', begin);
+        return end == std::string::npos ? "" : output.substr(begin, end - begin);
+    }
+
+    std::string build_prelude_pch(
+        const std::vector<std::string>& prelude,
+        const std::vector<const char*>& args,
+        const std::string& resource_dir,
+        const std::string& cache_dir,
+        bool rebuild
+    )
+    {
+        if (prelude.empty() || cache_dir.empty())
+        {
+            return "";
+        }
+        std::string clang = find_clang(resource_dir);
+        if (clang.empty())
+        {
+            return "";
+        }
+
+        fnv_hash hash;
+        hash.mix(clang);
+        hash.mix(mtime_string(clang));
+        for (const char* arg : args)
+        {
+            hash.mix(arg);
+        }
+        for (const std::string& header : prelude)
+        {
+            hash.mix(header);
+            // Headers given by path are tracked directly; headers found
+            // through the include paths are validated by clang when the PCH
+            // is loaded, and a rejected PCH is rebuilt.
+            hash.mix(mtime_string(header));
+        }
+
+        fs::path pch_dir = fs::path(cache_dir) / "pch";
+        fs::path pch_file = pch_dir / (hash.hex() + ".pch");
+        fs::path header_file = pch_dir / (hash.hex() + ".hpp");
+        std::error_code ec;
+        if (!rebuild && fs::exists(pch_file, ec) && fs::exists(header_file, ec))
+        {
+            return pch_file.string();
+        }
+
+        fs::create_directories(pch_dir, ec);
+        {
+            // The PCH records its main file, which must stay next to it.
+            std::ofstream out(header_file);
+            for (const std::string& header : prelude)
+            {
+                out << "#include \"" << header << "\"\n";
+            }
+            if (!out)
+            {
+                return "";
+            }
+        }
+
+        const std::string tmp_file = pch_file.string() + "."
+                                     + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        const fs::path log_file = pch_dir / (hash.hex() + ".log");
+
+        std::string command = shell_quote(clang);
+        command += is_c_mode(args) ? " -x c-header" : " -x c++-header";
+        for (const char* arg : args)
+        {
+            if (!skip_pch_argument(arg))
+            {
+                command += " " + shell_quote(arg);
+            }
+        }
+        // The interpreter parses in incremental mode, which is part of the
+        // language options a PCH is checked against.
+        command += " -Xclang -fincremental-extensions";
+        command += " " + shell_quote(header_file.string());
+        command += " -o " + shell_quote(tmp_file);
+        command += " > " + shell_quote(log_file.string()) + " 2>&1";
+#if defined(_WIN32)
+        // cmd.exe strips the outer quotes of a command starting with one.
+        command = "\"" + command + "\"";
+#endif
+
+        if (std::system(command.c_str()) != 0)
+        {
+            fs::remove(tmp_file, ec);
+            return "";
+        }
+        fs::rename(tmp_file, pch_file, ec);
+        if (ec)
+        {
+            fs::remove(tmp_file, ec);
+            return "";
+        }
+        fs::remove(log_file, ec);
+        return pch_file.string();
+    }
+}
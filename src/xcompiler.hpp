@@ -0,0 +1,78 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_COMPILER_HPP
+#define XEUS_CPP_COMPILER_HPP
+
+#include <string>
+#include <vector>
+
+#include "xeus-cpp/xeus_cpp_config.hpp"
+
+namespace xcpp
+{
+    struct compiler_paths
+    {
+        std::string resource_dir;
+        std::vector<std::string> system_includes;
+    };
+
+    // Resource directory and system include paths of the host toolchain, as
+    // found by Cpp::DetectResourceDir and Cpp::DetectSystemCompilerIncludePaths.
+    // Both spawn the system compiler, so their results are cached in
+    // <cache_dir>/compiler_paths.json, keyed by the path and modification
+    // time of the compilers they run. `rediscover` ignores the cached entry.
+    // Without `detect_resource_dir`, e.g. when the user passed -resource-dir,
+    // only the include paths are detected and the resource directory is
+    // returned if it was cached before.
+    XEUS_CPP_API compiler_paths detect_compiler_paths(
+        const std::string& cache_dir,
+        bool rediscover = false,
+        bool detect_resource_dir = true
+    );
+
+    // Full path of the executable `name` found in PATH, or an empty string.
+    XEUS_CPP_API std::string find_program(const std::string& name);
+
+    // Clang driver matching the interpreter. The driver installed next to
+    // `resource_dir` (<prefix>/lib/clang/<version>) is preferred, since the
+    // artifacts it produces must be readable by the interpreter; otherwise
+    // the first one found in PATH is used.
+    XEUS_CPP_API std::string find_clang(const std::string& resource_dir, bool cxx = true);
+
+    // Quotes `arg` for the platform shell used by std::system.
+    XEUS_CPP_API std::string shell_quote(const std::string& arg);
+
+    // Runs `command` in the platform shell, collecting its standard output
+    // and error in `output`. Returns the exit status, or -1 if the command
+    // could not be started.
+    XEUS_CPP_API int run_command(const std::string& command, std::string& output);
+
+    // Name of the host CPU as accepted by -march, i.e. what the Clang driver
+    // next to `resource_dir` resolves -march=native to. Returns an empty
+    // string if it cannot be found.
+    XEUS_CPP_API std::string host_cpu_name(const std::string& resource_dir);
+
+    // Returns a precompiled header for the `prelude` headers, compiled with
+    // the interpreter arguments `args`, building it under
+    // <cache_dir>/pch when it does not exist yet. The name of the PCH is a
+    // hash of the compiler, the arguments and the prelude, so a change of any
+    // of them produces a new PCH rather than one the interpreter rejects.
+    // Headers found through the include paths are only checked by the
+    // interpreter when it loads the PCH: `rebuild` replaces a PCH it
+    // rejected. Returns an empty string if no PCH could be built.
+    XEUS_CPP_API std::string build_prelude_pch(
+        const std::vector<std::string>& prelude,
+        const std::vector<const char*>& args,
+        const std::string& resource_dir,
+        const std::string& cache_dir,
+        bool rebuild = false
+    );
+}
+
+#endif
@@ -0,0 +1,677 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "clang/Interpreter/CppInterOp.h"
+
+#include "xcomplete.hpp"
+#include "xjournal.hpp"
+
+namespace xcpp
+{
+    namespace
+    {
+        std::vector<std::string> filter(const std::vector<std::string>& candidates, const std::string& prefix)
+        {
+            std::vector<std::string> res;
+            for (const std::string& candidate : candidates)
+            {
+                if (match_score(candidate, prefix) > 0)
+                {
+                    res.push_back(candidate);
+                }
+            }
+            return res;
+        }
+
+        // Whether the token completed at the end of `context` is a member
+        // or a qualified name, whose candidates are specific to the context.
+        bool is_qualified(const std::string& context)
+        {
+            std::size_t end = context.find_last_not_of(" \t\n");
+            return end != std::string::npos
+                   && (context[end] == '.' || (end > 0 && context.compare(end - 1, 2, "->") == 0)
+                       || (end > 0 && context.compare(end - 1, 2, "::") == 0));
+        }
+
+        bool is_identifier_char(char c)
+        {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        }
+
+        char lower(char c)
+        {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        // Whether a word of `s` starts at `i`: after an underscore, or at
+        // an upper case letter following a lower case one.
+        bool starts_word(const std::string& s, std::size_t i)
+        {
+            if (i == 0)
+            {
+                return true;
+            }
+            const auto c = static_cast<unsigned char>(s[i]);
+            const auto previous = static_cast<unsigned char>(s[i - 1]);
+            return previous == '_' || (std::isupper(c) && std::islower(previous))
+                   || (std::isalpha(c) && !std::isalnum(previous));
+        }
+
+        int fuzzy_score(const std::string& candidate, const std::string& query)
+        {
+            // The first character starts a word, the others follow in order.
+            std::size_t pos = 0;
+            while (pos < candidate.size() && !(lower(candidate[pos]) == lower(query[0]) && starts_word(candidate, pos)))
+            {
+                ++pos;
+            }
+            if (pos == candidate.size())
+            {
+                return 0;
+            }
+            int bonus = pos == 0 ? 20 : 10;
+            std::size_t last = pos;
+            for (std::size_t q = 1; q < query.size(); ++q)
+            {
+                pos = last + 1;
+                while (pos < candidate.size() && lower(candidate[pos]) != lower(query[q]))
+                {
+                    ++pos;
+                }
+                if (pos == candidate.size())
+                {
+                    return 0;
+                }
+                if (pos == last + 1)
+                {
+                    bonus += 5;
+                }
+                else if (starts_word(candidate, pos))
+                {
+                    bonus += 10;
+                }
+                last = pos;
+            }
+            const int gap = static_cast<int>(candidate.size() - query.size());
+            return std::clamp(300 + bonus - gap, 1, 599);
+        }
+
+        const std::set<std::string>& keywords()
+        {
+            static const std::set<std::string> res = {
+                "alignas",      "alignof",   "asm",         "auto",        "bool",       "break",
+                "case",         "catch",     "char",        "char16_t",    "char32_t",   "char8_t",
+                "class",        "co_await",  "co_return",   "co_yield",    "concept",    "const",
+                "const_cast",   "consteval", "constexpr",   "constinit",   "continue",   "decltype",
+                "default",      "delete",    "do",          "double",      "dynamic_cast", "else",
+                "enum",         "explicit",  "export",      "extern",      "false",      "float",
+                "for",          "friend",    "goto",        "if",          "inline",     "int",
+                "long",         "mutable",   "namespace",   "new",         "noexcept",   "nullptr",
+                "operator",     "private",   "protected",   "public",      "register",   "reinterpret_cast",
+                "requires",     "return",    "short",       "signed",      "sizeof",     "static",
+                "static_assert", "static_cast", "struct",   "switch",      "template",   "this",
+                "thread_local", "throw",     "true",        "try",         "typedef",    "typeid",
+                "typename",     "union",     "unsigned",    "using",       "virtual",    "void",
+                "volatile",     "wchar_t",   "while"
+            };
+            return res;
+        }
+
+        // Bonus for the type of a candidate: what is usually completed first.
+        int kind_bonus(const std::string& type)
+        {
+            if (type == "instance")
+            {
+                return 15;
+            }
+            if (type == "function")
+            {
+                return 10;
+            }
+            if (type == "class")
+            {
+                return 10;
+            }
+            if (type == "module" || type == "<unknown>")
+            {
+                return 5;
+            }
+            return 0;
+        }
+
+        // Name completed at the end of `context` and the operator after
+        // it: "std::chrono::", "v.", "p->", or "" for the global scope.
+        std::string trailing_qualifier(const std::string& context)
+        {
+            if (!is_qualified(context))
+            {
+                return "";
+            }
+            std::size_t end = context.find_last_not_of(" \t\n") + 1;
+            std::size_t begin = end - (context[end - 1] == '.' ? 1 : 2);
+            while (begin > 0)
+            {
+                if (is_identifier_char(context[begin - 1]))
+                {
+                    --begin;
+                }
+                else if (begin > 1 && context.compare(begin - 2, 2, "::") == 0)
+                {
+                    begin -= 2;
+                }
+                else
+                {
+                    break;
+                }
+            }
+            return context.substr(begin, end - begin);
+        }
+    }
+
+    int match_score(const std::string& candidate, const std::string& query)
+    {
+        if (query.empty())
+        {
+            return 1;
+        }
+        if (candidate.size() < query.size())
+        {
+            return 0;
+        }
+        const int gap = static_cast<int>(candidate.size() - query.size());
+        if (candidate.compare(0, query.size(), query) == 0)
+        {
+            return gap == 0 ? 1000 : std::max(900 - gap, 800);
+        }
+        if (std::equal(
+                query.begin(),
+                query.end(),
+                candidate.begin(),
+                [](char lhs, char rhs)
+                {
+                    return lower(lhs) == lower(rhs);
+                }
+            ))
+        {
+            return std::max(700 - gap, 600);
+        }
+        return fuzzy_score(candidate, query);
+    }
+
+    xcompletion_cache::xcompletion_cache(complete_function complete, std::size_t capacity)
+        : m_complete(std::move(complete))
+        , m_capacity(capacity > 0 ? capacity : 1)
+        , m_misses(0)
+        , m_pending{"", 0}
+        , m_has_pending(false)
+        , m_running{"", 0}
+        , m_busy(false)
+        , m_stop(false)
+    {
+    }
+
+    xcompletion_cache::~xcompletion_cache()
+    {
+        stop();
+    }
+
+    void xcompletion_cache::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            m_has_pending = false;
+        }
+        m_cv.notify_all();
+        if (m_worker.joinable())
+        {
+            m_worker.join();
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = false;
+    }
+
+    std::vector<std::string> xcompletion_cache::complete(
+        const std::string& context,
+        const std::string& prefix,
+        std::chrono::milliseconds budget
+    )
+    {
+        const std::size_t generation = get_journal().generation();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it = find(context, generation);
+        if (it != m_entries.end())
+        {
+            return filter(it->candidates, prefix);
+        }
+
+#if !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        if (budget.count() > 0)
+        {
+            const bool running = m_busy && m_running.context == context && m_running.generation == generation;
+            const bool pending = m_has_pending && m_pending.context == context
+                                 && m_pending.generation == generation;
+            if (!running && !pending)
+            {
+                ++m_misses;
+                m_pending = {context, generation};
+                m_has_pending = true;
+                if (!m_worker.joinable())
+                {
+                    m_worker = std::thread(&xcompletion_cache::run, this);
+                }
+                m_cv.notify_all();
+            }
+            const bool ready = m_cv.wait_for(
+                lock,
+                budget,
+                [this, &context, generation]()
+                {
+                    return find(context, generation) != m_entries.end();
+                }
+            );
+            return filter(ready ? m_entries.front().candidates : fallback(context), prefix);
+        }
+#endif
+
+        // The worker may still be parsing a previous request.
+        m_has_pending = false;
+        m_cv.wait(
+            lock,
+            [this]()
+            {
+                return !m_busy;
+            }
+        );
+        it = find(context, generation);
+        if (it != m_entries.end())
+        {
+            return filter(it->candidates, prefix);
+        }
+        ++m_misses;
+        lock.unlock();
+        std::vector<std::string> candidates = m_complete(context);
+        lock.lock();
+        insert({context, generation, candidates});
+        return filter(candidates, prefix);
+    }
+
+    void xcompletion_cache::wait_idle()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_has_pending = false;
+        m_cv.wait(
+            lock,
+            [this]()
+            {
+                return !m_busy;
+            }
+        );
+    }
+
+    bool xcompletion_cache::idle() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return !m_busy && !m_has_pending;
+    }
+
+    std::size_t xcompletion_cache::misses() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_misses;
+    }
+
+    void xcompletion_cache::clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.clear();
+    }
+
+    std::list<xcompletion_cache::entry>::iterator
+    xcompletion_cache::find(const std::string& context, std::size_t generation)
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if (it->context == context && it->generation == generation)
+            {
+                m_entries.splice(m_entries.begin(), m_entries, it);
+                return m_entries.begin();
+            }
+        }
+        return m_entries.end();
+    }
+
+    void xcompletion_cache::insert(entry e)
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if (it->context == e.context)
+            {
+                m_entries.erase(it);
+                break;
+            }
+        }
+        m_entries.push_front(std::move(e));
+        if (m_entries.size() > m_capacity)
+        {
+            m_entries.pop_back();
+        }
+    }
+
+    std::vector<std::string> xcompletion_cache::fallback(const std::string& context) const
+    {
+        // Candidates of the context computed before the last declarations.
+        for (const entry& e : m_entries)
+        {
+            if (e.context == context)
+            {
+                return e.candidates;
+            }
+        }
+        // Otherwise the names of the scope of the last completion, unless
+        // members or qualified names are completed.
+        if (!m_entries.empty() && !is_qualified(context) && !is_qualified(m_entries.front().context))
+        {
+            return m_entries.front().candidates;
+        }
+        return {};
+    }
+
+    void xcompletion_cache::run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_cv.wait(
+                lock,
+                [this]()
+                {
+                    return m_stop || m_has_pending;
+                }
+            );
+            if (m_stop)
+            {
+                return;
+            }
+            m_running = m_pending;
+            m_has_pending = false;
+            m_busy = true;
+            const job current = m_running;
+            lock.unlock();
+
+            std::vector<std::string> candidates;
+            try
+            {
+                candidates = m_complete(current.context);
+            }
+            catch (...)
+            {
+            }
+
+            lock.lock();
+            insert({current.context, current.generation, std::move(candidates)});
+            m_busy = false;
+            m_cv.notify_all();
+        }
+    }
+
+    xcompletion_cache& get_completion_cache()
+    {
+        static xcompletion_cache cache(
+            [](const std::string& code)
+            {
+                std::vector<std::string> candidates;
+                Cpp::CodeComplete(candidates, code.c_str(), 1, static_cast<unsigned>(code.size() + 1));
+                return candidates;
+            }
+        );
+        return cache;
+    }
+
+    completion_item xsymbol_index::describe(const std::string& context, const std::string& name)
+    {
+        refresh();
+        void* scope = scope_of(context);
+        auto key = std::make_pair(scope, name);
+        auto it = m_symbols.find(key);
+        if (it != m_symbols.end())
+        {
+            return it->second;
+        }
+
+        completion_item item{name, "<unknown>", ""};
+        if (scope != nullptr)
+        {
+            std::vector<Cpp::TCppFunction_t> functions = Cpp::GetFunctionsUsingName(scope, name);
+            Cpp::TCppScope_t named = functions.empty() ? Cpp::GetNamed(name, scope) : nullptr;
+            if (!functions.empty())
+            {
+                item.type = "function";
+                item.signature = Cpp::GetFunctionSignature(functions.front());
+                if (functions.size() > 1)
+                {
+                    item.signature += " (+" + std::to_string(functions.size() - 1) + " overloads)";
+                }
+            }
+            else if (named != nullptr)
+            {
+                if (Cpp::IsNamespace(named))
+                {
+                    item.type = "module";
+                }
+                else if (Cpp::IsClass(named) || Cpp::IsEnumScope(named) || Cpp::IsTemplate(named))
+                {
+                    item.type = "class";
+                }
+                else if (Cpp::IsVariable(named))
+                {
+                    item.type = "instance";
+                    item.signature = Cpp::GetTypeAsString(Cpp::GetVariableType(named));
+                }
+            }
+            else if (Cpp::ExistsFunctionTemplate(name, scope))
+            {
+                item.type = "function";
+            }
+        }
+        if (item.type == "<unknown>" && keywords().count(name) != 0)
+        {
+            item.type = "keyword";
+        }
+        m_symbols.emplace(std::move(key), item);
+        return item;
+    }
+
+    double xsymbol_index::recency(const std::string& name)
+    {
+        refresh();
+        auto it = m_last_use.find(name);
+        if (it == m_last_use.end() || m_indexed == 0)
+        {
+            return 0.;
+        }
+        return static_cast<double>(it->second) / static_cast<double>(m_indexed);
+    }
+
+    void xsymbol_index::refresh()
+    {
+        const xjournal& journal = get_journal();
+        if (journal.generation() == m_generation)
+        {
+            return;
+        }
+        // Every entry recorded changes the generation once: anything else
+        // means a rollback, after which the entries are indexed again.
+        if (journal.size() < m_indexed || journal.generation() - m_generation != journal.size() - m_indexed)
+        {
+            m_indexed = 0;
+            m_last_use.clear();
+        }
+        m_generation = journal.generation();
+        m_scopes.clear();
+        m_symbols.clear();
+
+        const std::vector<xjournal::entry>& entries = journal.entries();
+        for (; m_indexed < entries.size(); ++m_indexed)
+        {
+            if (entries[m_indexed].internal)
+            {
+                continue;
+            }
+            const std::string& code = entries[m_indexed].code;
+            std::size_t i = 0;
+            while (i < code.size())
+            {
+                if (!is_identifier_char(code[i]) || std::isdigit(static_cast<unsigned char>(code[i])))
+                {
+                    ++i;
+                    continue;
+                }
+                std::size_t begin = i;
+                while (i < code.size() && is_identifier_char(code[i]))
+                {
+                    ++i;
+                }
+                m_last_use[code.substr(begin, i - begin)] = m_indexed + 1;
+            }
+        }
+    }
+
+    void* xsymbol_index::scope_of(const std::string& context)
+    {
+        std::string qualifier = trailing_qualifier(context);
+        auto it = m_scopes.find(qualifier);
+        if (it != m_scopes.end())
+        {
+            return it->second;
+        }
+
+        Cpp::TCppScope_t scope = nullptr;
+        if (qualifier.empty() || qualifier == "::")
+        {
+            scope = Cpp::GetGlobalScope();
+        }
+        else if (qualifier.back() == ':')
+        {
+            scope = Cpp::GetScopeFromCompleteName(qualifier.substr(0, qualifier.size() - 2));
+            if (scope != nullptr)
+            {
+                scope = Cpp::GetUnderlyingScope(scope);
+            }
+        }
+        else
+        {
+            std::string name = qualifier.substr(0, qualifier.size() - (qualifier.back() == '.' ? 1 : 2));
+            std::size_t sep = name.rfind("::");
+            Cpp::TCppScope_t parent = sep == std::string::npos
+                                          ? Cpp::GetGlobalScope()
+                                          : Cpp::GetScopeFromCompleteName(name.substr(0, sep));
+            Cpp::TCppScope_t variable = nullptr;
+            if (parent != nullptr)
+            {
+                variable = Cpp::GetNamed(sep == std::string::npos ? name : name.substr(sep + 2), parent);
+            }
+            if (variable != nullptr && Cpp::IsVariable(variable))
+            {
+                scope = Cpp::GetScopeFromType(Cpp::GetVariableType(variable));
+            }
+        }
+        m_scopes.emplace(std::move(qualifier), scope);
+        return scope;
+    }
+
+    xsymbol_index& get_symbol_index()
+    {
+        static xsymbol_index index;
+        return index;
+    }
+
+    std::vector<completion_item> rank_completions(
+        const std::vector<std::string>& candidates,
+        const std::string& query,
+        const std::function<completion_item(const std::string&)>& describe,
+        const std::function<double(const std::string&)>& recency,
+        std::size_t max_described
+    )
+    {
+        struct ranked
+        {
+            completion_item item;
+            int score;
+        };
+
+        std::vector<ranked> res;
+        std::set<std::string> seen;
+        for (const std::string& candidate : candidates)
+        {
+            // Names the kernel declares for itself, such as the markers of
+            // the transactions, are not offered.
+            if (candidate.rfind("__xcpp_", 0) == 0)
+            {
+                continue;
+            }
+            const int match = match_score(candidate, query);
+            if (match == 0 || !seen.insert(candidate).second)
+            {
+                continue;
+            }
+            // Bonuses stay below the gap between two kinds of match, so
+            // that an exact match or a prefix always comes first.
+            const double used = recency(candidate);
+            const int usage = used > 0. ? 40 + static_cast<int>(std::lround(40. * used)) : 0;
+            res.push_back({completion_item{candidate, "<unknown>", ""}, match + usage});
+        }
+
+        auto better = [](const ranked& lhs, const ranked& rhs)
+        {
+            if (lhs.score != rhs.score)
+            {
+                return lhs.score > rhs.score;
+            }
+            if (lhs.item.text.size() != rhs.item.text.size())
+            {
+                return lhs.item.text.size() < rhs.item.text.size();
+            }
+            return lhs.item.text < rhs.item.text;
+        };
+        std::stable_sort(res.begin(), res.end(), better);
+
+        // Describing a candidate looks it up in the interpreter, which is
+        // only done for the best ones, e.g. not for the thousands of names
+        // of std::. Their type then refines their order.
+        const std::size_t described = std::min(res.size(), max_described);
+        for (std::size_t i = 0; i < res.size(); ++i)
+        {
+            if (i < described)
+            {
+                const std::string text = res[i].item.text;
+                res[i].item = describe(text);
+                res[i].item.text = text;
+            }
+            res[i].score += kind_bonus(res[i].item.type);
+        }
+        std::stable_sort(res.begin(), res.begin() + static_cast<std::ptrdiff_t>(described), better);
+
+        std::vector<completion_item> items;
+        items.reserve(res.size());
+        for (ranked& r : res)
+        {
+            items.push_back(std::move(r.item));
+        }
+        return items;
+    }
+}
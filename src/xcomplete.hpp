@@ -0,0 +1,200 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_COMPLETE_HPP
+#define XEUS_CPP_COMPLETE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "xeus-cpp/xeus_cpp_config.hpp"
+
+namespace xcpp
+{
+    /**
+     * Cache of code completion candidates.
+     *
+     * Frontends send a completion request for each character typed, and
+     * each one used to parse the whole cell again. The candidates only
+     * depend on the code before the token being completed, the context, and
+     * on the declarations of the session: they are computed once per
+     * context and filtered with the characters of the token typed so far.
+     * They are computed again once the journal changes, i.e. when a cell
+     * added declarations or a rollback removed some.
+     *
+     * With a time budget, the candidates are computed on a worker thread.
+     * When they are not ready in time, the request is answered with the
+     * candidates computed for the same context before the declarations
+     * changed, or for the previous context, and the worker keeps going so
+     * that the next request finds them in the cache. A request for another
+     * context replaces the one waiting for the worker, if any; a parse that
+     * has started cannot be interrupted and runs to completion.
+     */
+    class XEUS_CPP_API xcompletion_cache
+    {
+    public:
+
+        // Candidates of a completion at the end of `code`.
+        using complete_function = std::function<std::vector<std::string>(const std::string& code)>;
+
+        explicit xcompletion_cache(complete_function complete, std::size_t capacity = 16);
+        ~xcompletion_cache();
+
+        xcompletion_cache(const xcompletion_cache&) = delete;
+        xcompletion_cache& operator=(const xcompletion_cache&) = delete;
+
+        // Candidates for the token starting at the end of `context`, whose
+        // first characters are `prefix`. A zero budget waits for them.
+        std::vector<std::string> complete(
+            const std::string& context,
+            const std::string& prefix,
+            std::chrono::milliseconds budget = std::chrono::milliseconds(0)
+        );
+
+        // Drops the pending request and waits for the worker to be done
+        // with the interpreter, which must be called before anything else
+        // uses it.
+        void wait_idle();
+
+        // Stops the worker thread, which the next request with a budget
+        // starts again, e.g. before the process forks.
+        void stop();
+
+        // Whether the worker is not using the interpreter. It only starts
+        // again from a call to complete.
+        bool idle() const;
+
+        // Number of times the candidates were computed, or requested from
+        // the worker.
+        std::size_t misses() const;
+
+        void clear();
+
+    private:
+
+        struct entry
+        {
+            std::string context;
+            std::size_t generation;
+            std::vector<std::string> candidates;
+        };
+
+        struct job
+        {
+            std::string context;
+            std::size_t generation;
+        };
+
+        // Fresh entry of `context`, moved to the front, or end().
+        std::list<entry>::iterator find(const std::string& context, std::size_t generation);
+        void insert(entry e);
+        // Candidates answering a request that ran out of time.
+        std::vector<std::string> fallback(const std::string& context) const;
+        void run();
+
+        complete_function m_complete;
+        std::size_t m_capacity;
+        // Most recently used first.
+        std::list<entry> m_entries;
+        std::size_t m_misses;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        job m_pending;
+        bool m_has_pending;
+        job m_running;
+        bool m_busy;
+        bool m_stop;
+        std::thread m_worker;
+    };
+
+    // Cache of the kernel interpreter, computing the candidates with
+    // Cpp::CodeComplete.
+    XEUS_CPP_API xcompletion_cache& get_completion_cache();
+
+    // Score of `candidate` for the characters typed, `query`, 0 if it does
+    // not match. Exact matches score highest, then prefixes, prefixes
+    // ignoring case, and fuzzy matches: the characters of the query in
+    // order, the first one starting a word of the candidate, e.g. "uptr"
+    // for unique_ptr. Shorter candidates score higher.
+    XEUS_CPP_API int match_score(const std::string& candidate, const std::string& query);
+
+    struct completion_item
+    {
+        std::string text;
+        // Jupyter completion type: function, class, module, instance,
+        // keyword, or <unknown>.
+        std::string type;
+        std::string signature;
+    };
+
+    /**
+     * Symbols of the session, to rank and describe completion candidates.
+     *
+     * The type and signature of each candidate are looked up once in the
+     * scope the completion looks into, and kept until the declarations
+     * change. The identifiers used by the inputs of the session are indexed
+     * from the journal, as it grows.
+     */
+    class XEUS_CPP_API xsymbol_index
+    {
+    public:
+
+        // Description of `name` in the scope completed at the end of
+        // `context`: after a qualifier, a member access on a variable, or
+        // the global scope.
+        completion_item describe(const std::string& context, const std::string& name);
+
+        // Between 0, for names no input used, and 1, for names used by the
+        // last input.
+        double recency(const std::string& name);
+
+    private:
+
+        void refresh();
+        void* scope_of(const std::string& context);
+
+        std::size_t m_generation = 0;
+        std::size_t m_indexed = 0;
+        std::unordered_map<std::string, std::size_t> m_last_use;
+        std::unordered_map<std::string, void*> m_scopes;
+        std::map<std::pair<void*, std::string>, completion_item> m_symbols;
+    };
+
+    XEUS_CPP_API xsymbol_index& get_symbol_index();
+
+    /**
+     * Candidates matching `query`, best first: by match score, then by how
+     * recently the session used them and by their type, variables and
+     * functions before types, namespaces and keywords. The names reserved
+     * to the kernel (`__xcpp_*`) are left out.
+     *
+     * Only the `max_described` best candidates by match and recency are
+     * passed to `describe` and ordered by type, the others are of unknown
+     * type and follow them.
+     */
+    XEUS_CPP_API std::vector<completion_item> rank_completions(
+        const std::vector<std::string>& candidates,
+        const std::string& query,
+        const std::function<completion_item(const std::string&)>& describe,
+        const std::function<double(const std::string&)>& recency,
+        std::size_t max_described = 50
+    );
+}
+
+#endif
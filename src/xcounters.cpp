@@ -0,0 +1,261 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "xcounters.hpp"
+
+namespace xcpp
+{
+    namespace
+    {
+#if defined(__linux__) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        struct event_spec
+        {
+            const char* name;
+            std::uint32_t type;
+            std::uint64_t config;
+        };
+
+        constexpr std::uint64_t cache_event(std::uint64_t cache, std::uint64_t result)
+        {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+        }
+
+        const event_spec hardware_events[] = {
+            {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {"branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+            {"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {"L1-dcache-loads",
+             PERF_TYPE_HW_CACHE,
+             cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+            {"L1-dcache-load-misses",
+             PERF_TYPE_HW_CACHE,
+             cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+            {"LLC-loads", PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+            {"LLC-load-misses",
+             PERF_TYPE_HW_CACHE,
+             cache_event(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_MISS)}
+        };
+
+        const event_spec software_events[] = {
+            {"task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+            {"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+            {"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+        };
+
+        int open_event(const event_spec& spec)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = spec.type;
+            attr.config = spec.config;
+            attr.disabled = 1;
+            // Counts the threads started by the cell too.
+            attr.inherit = 1;
+            // Required with perf_event_paranoid >= 2, the default.
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        }
+#endif
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        void sample_usage(double* values)
+        {
+            timespec ts;
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            values[0] = static_cast<double>(ts.tv_sec) * 1e9 + static_cast<double>(ts.tv_nsec);
+            rusage usage;
+#if defined(__linux__)
+            getrusage(RUSAGE_THREAD, &usage);
+#else
+            getrusage(RUSAGE_SELF, &usage);
+#endif
+            values[1] = static_cast<double>(usage.ru_nvcsw + usage.ru_nivcsw);
+            values[2] = static_cast<double>(usage.ru_minflt + usage.ru_majflt);
+        }
+#else
+        void sample_usage(double* values)
+        {
+            values[0] = values[1] = values[2] = 0;
+        }
+#endif
+
+        const char* usage_names[] = {"task-clock", "context-switches", "page-faults"};
+    }
+
+    xcounters::xcounters()
+        : m_opened(false)
+        , m_enabled(false)
+        , m_start{0, 0, 0}
+        , m_total{0, 0, 0}
+    {
+    }
+
+    void xcounters::open()
+    {
+        m_opened = true;
+#if defined(__linux__) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        // Without the software events, perf_event_open is not permitted at
+        // all, e.g. filtered by seccomp, and getrusage is used instead.
+        std::vector<event> software;
+        for (const event_spec& spec : software_events)
+        {
+            int fd = open_event(spec);
+            if (fd < 0)
+            {
+                for (event& e : software)
+                {
+                    ::close(e.fd);
+                }
+                return;
+            }
+            software.push_back({spec.name, fd, false});
+        }
+        for (const event_spec& spec : hardware_events)
+        {
+            m_events.push_back({spec.name, open_event(spec), true});
+        }
+        m_events.insert(m_events.end(), software.begin(), software.end());
+#endif
+    }
+
+    xcounters::~xcounters()
+    {
+        for (event& e : m_events)
+        {
+            if (e.fd >= 0)
+            {
+                ::close(e.fd);
+            }
+        }
+    }
+
+    void xcounters::enable()
+    {
+        if (m_enabled)
+        {
+            return;
+        }
+        if (!m_opened)
+        {
+            open();
+        }
+        m_enabled = true;
+#if defined(__linux__) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        if (has_perf_events())
+        {
+            for (const event& e : m_events)
+            {
+                if (e.fd >= 0)
+                {
+                    ioctl(e.fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+            return;
+        }
+#endif
+        sample_usage(m_start);
+    }
+
+    void xcounters::disable()
+    {
+        if (!m_enabled)
+        {
+            return;
+        }
+        m_enabled = false;
+#if defined(__linux__) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        if (has_perf_events())
+        {
+            for (const event& e : m_events)
+            {
+                if (e.fd >= 0)
+                {
+                    ioctl(e.fd, PERF_EVENT_IOC_DISABLE, 0);
+                }
+            }
+            return;
+        }
+#endif
+        double now[3];
+        sample_usage(now);
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            m_total[i] += now[i] - m_start[i];
+        }
+    }
+
+    bool xcounters::has_hardware_events() const
+    {
+        for (const event& e : m_events)
+        {
+            if (e.hardware && e.fd >= 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool xcounters::has_perf_events() const
+    {
+        return !m_events.empty();
+    }
+
+    std::vector<counter_reading> xcounters::read() const
+    {
+        std::vector<counter_reading> res;
+        if (!has_perf_events())
+        {
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                res.push_back({usage_names[i], m_total[i], 1, true});
+            }
+            return res;
+        }
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        for (const event& e : m_events)
+        {
+            // value, time enabled and time running.
+            std::uint64_t values[3] = {0, 0, 0};
+            if (e.fd < 0 || ::read(e.fd, values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)))
+            {
+                res.push_back({e.name, 0, 0, false});
+                continue;
+            }
+            // The kernel multiplexes the events when there are more than
+            // hardware counters, the counts are extrapolated to the time
+            // they were enabled.
+            const double running = values[1] > 0 ? static_cast<double>(values[2]) / static_cast<double>(values[1])
+                                                 : 0;
+            const double value = running > 0 ? static_cast<double>(values[0]) / running : 0;
+            res.push_back({e.name, value, running, true});
+        }
+#endif
+        return res;
+    }
+}
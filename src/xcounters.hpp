@@ -0,0 +1,86 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_COUNTERS_HPP
+#define XEUS_CPP_COUNTERS_HPP
+
+#include <string>
+#include <vector>
+
+#include "xeus-cpp/xeus_cpp_config.hpp"
+
+namespace xcpp
+{
+    struct counter_reading
+    {
+        // Name of the event, as perf stat names it.
+        std::string name;
+        // Count, scaled up when the event was multiplexed. task-clock is in
+        // nanoseconds.
+        double value;
+        // Fraction of the time the event was actually counted.
+        double running;
+        bool supported;
+    };
+
+    /**
+     * Performance counters of the calling thread and of the threads it
+     * starts.
+     *
+     * On Linux, hardware and software events are counted with
+     * perf_event_open. Hardware events are often unavailable, in containers,
+     * virtual machines or with a restrictive perf_event_paranoid, and are
+     * then reported as not supported. When perf_event_open itself is not
+     * permitted, the software events are measured with getrusage instead.
+     *
+     * The events are opened by the first call to enable(), so that the
+     * threads started between the construction and then (e.g. to capture
+     * the output of a cell) are not counted.
+     */
+    class XEUS_CPP_API xcounters
+    {
+    public:
+
+        xcounters();
+        ~xcounters();
+
+        xcounters(const xcounters&) = delete;
+        xcounters& operator=(const xcounters&) = delete;
+
+        // Counting can be enabled and disabled several times, the counts
+        // add up.
+        void enable();
+        void disable();
+
+        bool has_hardware_events() const;
+        bool has_perf_events() const;
+
+        std::vector<counter_reading> read() const;
+
+    private:
+
+        struct event
+        {
+            std::string name;
+            int fd;
+            bool hardware;
+        };
+
+        void open();
+
+        std::vector<event> m_events;
+        bool m_opened;
+        bool m_enabled;
+
+        // getrusage fallback: task-clock, context-switches and page-faults.
+        double m_start[3];
+        double m_total[3];
+    };
+}
+
+#endif
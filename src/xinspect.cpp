@@ -13,6 +13,7 @@
 #include <utility>
 
 #include "xinspect.hpp"
+#include "xjournal.hpp"
 
 #include "clang/Interpreter/CppInterOp.h"
 
@@ -72,7 +73,7 @@ namespace xcpp
         std::string id = "__Xeus_GetType_" + std::to_string(var_count++);
         std::string using_clause = "using " + id + " = __typeof__(" + expression + ");\n";
 
-        if (!Cpp::Declare(using_clause.c_str(), false))
+        if (!journal_declare(using_clause, false))
         {
             Cpp::TCppScope_t lookup = Cpp::GetNamed(id, nullptr);
             Cpp::TCppType_t lookup_ty = Cpp::GetTypeFromScope(lookup);
@@ -98,6 +99,98 @@ namespace xcpp
         return result;
     }
 
+    /*******************************
+     * xdoc_catalog implementation *
+     *******************************/
+
+    xdoc_catalog::xdoc_catalog()
+        : xdoc_catalog(retrieve_tagconf_dir(), retrieve_tagfile_dir(), retrieve_cache_dir())
+    {
+    }
+
+    xdoc_catalog::xdoc_catalog(
+        std::string tagconf_dir,
+        std::string tagfile_dir,
+        std::string cache_dir,
+        clock_type::duration check_interval
+    )
+        : m_tagconf_dir(std::move(tagconf_dir))
+        , m_tagfile_dir(std::move(tagfile_dir))
+        , m_cache_dir(std::move(cache_dir))
+        , m_check_interval(check_interval)
+        , m_loaded(false)
+    {
+    }
+
+    const std::vector<xdoc_catalog::source>& xdoc_catalog::sources()
+    {
+        auto now = clock_type::now();
+        if (!m_loaded)
+        {
+            reload();
+            m_last_check = now;
+        }
+        else if (now - m_last_check >= m_check_interval)
+        {
+            m_last_check = now;
+            if (stamp() != m_stamp)
+            {
+                reload();
+            }
+        }
+        return m_sources;
+    }
+
+    std::vector<std::filesystem::file_time_type> xdoc_catalog::stamp() const
+    {
+        std::vector<std::filesystem::file_time_type> result;
+        result.reserve(m_watched.size());
+        for (const std::string& path : m_watched)
+        {
+            std::error_code ec;
+            result.push_back(std::filesystem::last_write_time(path, ec));
+        }
+        return result;
+    }
+
+    void xdoc_catalog::reload()
+    {
+        // The directory itself is watched so that added or removed tagconfs
+        // are noticed, the files so that in-place edits are noticed too.
+        m_watched = {m_tagconf_dir};
+        m_sources.clear();
+        try
+        {
+            for (const auto& entry : std::filesystem::directory_iterator(m_tagconf_dir))
+            {
+                if (entry.path().extension() == ".json")
+                {
+                    m_watched.push_back(entry.path().string());
+                }
+            }
+
+            nl::json tagconfs = read_tagconfs(m_tagconf_dir.c_str());
+            for (nl::json::const_iterator it = tagconfs.cbegin(); it != tagconfs.cend(); ++it)
+            {
+                source src;
+                src.url = it->at("url");
+                std::string tagfile = it->at("tagfile");
+                std::string filename = m_tagfile_dir + "/" + tagfile;
+                m_watched.push_back(filename);
+                if (src.index.load(filename, m_cache_dir))
+                {
+                    m_sources.push_back(std::move(src));
+                }
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to load documentation tagfiles: " << e.what() << "\n";
+        }
+        m_stamp = stamp();
+        m_loaded = true;
+    }
+
     std::pair<bool, std::smatch> is_inspect_request(const std::string& code, const std::regex& re)
     {
         std::smatch inspect;
@@ -108,17 +201,12 @@ namespace xcpp
         return std::make_pair(false, inspect);
     }
 
-    void inspect(const std::string& code, nl::json& kernel_res)
+    void inspect(const std::string& code, nl::json& kernel_res, xdoc_catalog& catalog)
     {
-        std::string tagconf_dir = retrieve_tagconf_dir();
-        std::string tagfiles_dir = retrieve_tagfile_dir();
-
-        nl::json tagconfs = read_tagconfs(tagconf_dir.c_str());
+        const std::vector<xdoc_catalog::source>& sources = catalog.sources();
 
         std::vector<std::string> check{"class", "struct", "function"};
 
-        std::string url, tagfile;
-
         std::regex re_expression(R"((((?:\w*(?:\:{2}|\<.*\>|\(.*\)|\[.*\])?)\.?)*))");
 
         std::smatch inspect = is_inspect_request(code, re_expression).second;
@@ -136,18 +224,12 @@ namespace xcpp
 
             if (!type_name.empty())
             {
-                for (nl::json::const_iterator it = tagconfs.cbegin(); it != tagconfs.cend(); ++it)
+                for (const xdoc_catalog::source& source : sources)
                 {
-                    url = it->at("url");
-                    tagfile = it->at("tagfile");
-                    std::string filename = tagfiles_dir + "/" + tagfile;
-                    pugi::xml_document doc;
-                    pugi::xml_parse_result result = doc.load_file(filename.c_str());
-                    class_member_predicate predicate{type_name, "function", method[2]};
-                    auto node = doc.find_node(predicate);
-                    if (!node.empty())
+                    std::string filename = source.index.find_member(type_name, method[2]);
+                    if (!filename.empty())
                     {
-                        inspect_result = url + predicate.get_filename(node);
+                        inspect_result = source.url + filename;
                     }
                 }
             }
@@ -170,30 +252,14 @@ namespace xcpp
                 find_string = (type_name.empty()) ? to_inspect : type_name;
             }
 
-            for (nl::json::const_iterator it = tagconfs.cbegin(); it != tagconfs.cend(); ++it)
+            for (const xdoc_catalog::source& source : sources)
             {
-                url = it->at("url");
-                tagfile = it->at("tagfile");
-                std::string filename = tagfiles_dir + "/" + tagfile;
-                pugi::xml_document doc;
-                pugi::xml_parse_result result = doc.load_file(filename.c_str());
-                for (auto c : check)
+                for (const auto& c : check)
                 {
-                    node_predicate predicate{c, find_string};
-                    std::string node;
-
-                    if (c == "class" || c == "struct")
-                    {
-                        node = doc.find_node(predicate).child("filename").child_value();
-                    }
-                    else
-                    {
-                        node = doc.find_node(predicate).child("anchorfile").child_value();
-                    }
-
+                    std::string node = source.index.find(c, find_string);
                     if (!node.empty())
                     {
-                        inspect_result = url + node;
+                        inspect_result = source.url + node;
                     }
                 }
             }
@@ -247,7 +313,8 @@ namespace xcpp
         }
     }
 
-    xintrospection::xintrospection()
+    xintrospection::xintrospection(xdoc_catalog& catalog)
+        : p_catalog(&catalog)
     {
         pattern = spattern;
     }
@@ -257,7 +324,7 @@ namespace xcpp
         std::regex re(spattern + R"((.*))");
         std::smatch to_inspect;
         std::regex_search(code, to_inspect, re);
-        inspect(to_inspect[1], kernel_res);
+        inspect(to_inspect[1], kernel_res, *p_catalog);
     }
 
     std::unique_ptr<xpreamble> xintrospection::clone() const
@@ -8,9 +8,11 @@
 #ifndef XEUS_CPP_INSPECT_HPP
 #define XEUS_CPP_INSPECT_HPP
 
+#include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include <pugixml.hpp>
 
@@ -18,6 +20,7 @@
 #include "xeus-cpp/xutils.hpp"
 
 #include "xparser.hpp"
+#include "xtagindex.hpp"
 
 namespace xcpp
 {
@@ -43,9 +46,58 @@ namespace xcpp
 
     nl::json read_tagconfs(const char* path);
 
+    /**
+     * Documentation catalog owned by the interpreter.
+     *
+     * Tagconfs and tagfile indices are loaded lazily on first use and kept
+     * resident. The tagconf directory, the tagconf files and the tagfiles are
+     * stat'ed at most once per check interval, and everything is reloaded
+     * only when one of their modification times changed, so that repeated
+     * inspect requests do not touch the filesystem while new tag
+     * configurations can still be dropped in at runtime.
+     */
+    class XEUS_CPP_API xdoc_catalog
+    {
+    public:
+
+        struct source
+        {
+            std::string url;
+            xtag_index index;
+        };
+
+        using clock_type = std::chrono::steady_clock;
+
+        xdoc_catalog();
+        xdoc_catalog(
+            std::string tagconf_dir,
+            std::string tagfile_dir,
+            std::string cache_dir,
+            clock_type::duration check_interval = std::chrono::seconds(1)
+        );
+
+        const std::vector<source>& sources();
+
+    private:
+
+        std::vector<std::filesystem::file_time_type> stamp() const;
+        void reload();
+
+        std::string m_tagconf_dir;
+        std::string m_tagfile_dir;
+        std::string m_cache_dir;
+        clock_type::duration m_check_interval;
+
+        bool m_loaded;
+        clock_type::time_point m_last_check;
+        std::vector<std::string> m_watched;
+        std::vector<std::filesystem::file_time_type> m_stamp;
+        std::vector<source> m_sources;
+    };
+
     XEUS_CPP_API std::pair<bool, std::smatch> is_inspect_request(const std::string& code, const std::regex& re);
 
-    XEUS_CPP_API void inspect(const std::string& code, nl::json& kernel_res);
+    XEUS_CPP_API void inspect(const std::string& code, nl::json& kernel_res, xdoc_catalog& catalog);
 
     class XEUS_CPP_API xintrospection : public xpreamble
     {
@@ -54,11 +106,15 @@ namespace xcpp
         using xpreamble::pattern;
         const std::string spattern = R"(^\?)";
 
-        xintrospection();
+        explicit xintrospection(xdoc_catalog& catalog);
 
         void apply(const std::string& code, nl::json& kernel_res) override;
 
         [[nodiscard]] std::unique_ptr<xpreamble> clone() const override;
+
+    private:
+
+        xdoc_catalog* p_catalog;
     };
 }
 
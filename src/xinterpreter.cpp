@@ -13,11 +13,25 @@
 #include "xeus-cpp/xbuffer.hpp"
 #include "xeus-cpp/xeus_cpp_config.hpp"
 #include "xeus-cpp/xinterpreter.hpp"
+#include "xeus-cpp/xinterrupt.hpp"
 #include "xeus-cpp/xmagics.hpp"
+#include "xeus-cpp/xoptions.hpp"
+#include "xeus-cpp/xutils.hpp"
 
+#include "xallocations.hpp"
+#include "xcompiler.hpp"
+#include "xcomplete.hpp"
+#include "xcapture.hpp"
 #include "xinput.hpp"
 #include "xinspect.hpp"
+#include "xjournal.hpp"
+#include "xmagics/checkpoint.hpp"
+#include "xmagics/codegen.hpp"
+#include "xmagics/executable.hpp"
+#include "xmagics/execution.hpp"
 #include "xmagics/os.hpp"
+#include "xmagics/profile.hpp"
+#include <csignal>
 #include <iostream>
 #ifndef EMSCRIPTEN
 #include "xmagics/xassist.hpp"
@@ -27,34 +41,122 @@
 
 using Args = std::vector<const char*>;
 
-void* createInterpreter(const Args &ExtraArgs = {}) {
+// `OptLevel` receives the optimization level of the JIT pipeline, and
+// `OptimizeCells` whether it applies to the cells by default.
+void* createInterpreter(const Args &ExtraArgs, const xcpp::kernel_options& Options,
+                        std::string& OptLevel, bool& OptimizeCells) {
   Args ClangArgs = {/*"-xc++"*/"-v"};
-  if (std::find_if(ExtraArgs.begin(), ExtraArgs.end(), [](const std::string& s) {
-    return s == "-resource-dir";}) == ExtraArgs.end()) {
-    std::string resource_dir = Cpp::DetectResourceDir();
+  std::string resource_dir;
+  auto resource_it = std::find_if(ExtraArgs.begin(), ExtraArgs.end(), [](const std::string& s) {
+    return s == "-resource-dir";});
+  // Detecting the paths spawns the system compiler, the result is cached
+  // across kernel launches.
+  xcpp::compiler_paths Paths = xcpp::detect_compiler_paths(xcpp::retrieve_cache_dir(),
+                                                          Options.rediscover_compiler_paths,
+                                                          resource_it == ExtraArgs.end());
+  if (resource_it == ExtraArgs.end()) {
+    resource_dir = Paths.resource_dir;
     if (!resource_dir.empty()) {
         ClangArgs.push_back("-resource-dir");
         ClangArgs.push_back(resource_dir.c_str());
     } else {
         std::cerr << "Failed to detect the resource-dir\n";
     }
+  } else if (std::next(resource_it) != ExtraArgs.end()) {
+    resource_dir = *std::next(resource_it);
   }
-  std::vector<std::string> CxxSystemIncludes;
-  Cpp::DetectSystemCompilerIncludePaths(CxxSystemIncludes);
-  for (const std::string& CxxInclude : CxxSystemIncludes) {
+  for (const std::string& CxxInclude : Paths.system_includes) {
     ClangArgs.push_back("-isystem");
     ClangArgs.push_back(CxxInclude.c_str());
   }
   ClangArgs.insert(ClangArgs.end(), ExtraArgs.begin(), ExtraArgs.end());
-  // FIXME: We should process the kernel input options and conditionally pass
-  // the gpu args here.
-  return Cpp::CreateInterpreter(ClangArgs/*, {"-cuda"}*/);
+
+  // Clang cannot change the optimization level of a single input, so when
+  // %%opt is enabled without optimizing the cells, the JIT runs an
+  // optimizing pipeline and the other cells are compiled under
+  // `#pragma clang optimize off`, which also keeps their compilation fast.
+  // Without an -O flag, --jit-opt-level or --enable-opt-magic, the pipeline
+  // of the interpreter is left as is.
+  OptLevel = xcpp::opt_level_from_args(ExtraArgs);
+  std::string DefaultLevel = !Options.jit_opt_level.empty() ? Options.jit_opt_level
+                             : !OptLevel.empty()           ? OptLevel
+                                                           : "0";
+  std::string OptFlag;
+  if (OptLevel.empty()) {
+    OptLevel = DefaultLevel == "0" && Options.enable_opt_magic ? "2" : DefaultLevel;
+    if (OptLevel != "0") {
+      OptFlag = "-O" + OptLevel;
+      ClangArgs.push_back(OptFlag.c_str());
+    }
+  }
+  OptimizeCells = DefaultLevel != "0";
+  // %%prof walks the stacks through the frame pointers, which optimized
+  // code omits unless told otherwise.
+  const bool FramePointerGiven = std::any_of(ExtraArgs.begin(), ExtraArgs.end(), [](const std::string& s) {
+    return s.find("omit-frame-pointer") != std::string::npos;
+  });
+  if (OptLevel != "0" && !FramePointerGiven) {
+    ClangArgs.push_back("-fno-omit-frame-pointer");
+  }
+
+  // The prelude headers are compiled once into a PCH that every kernel
+  // started with the same arguments loads, instead of being parsed again at
+  // each startup. A PCH the interpreter rejects, e.g. after a header found
+  // through the include paths changed, is rebuilt once. If it cannot be
+  // built or is still rejected, they are included textually.
+  std::string pch;
+#ifndef EMSCRIPTEN
+  pch = xcpp::build_prelude_pch(Options.prelude, ClangArgs, resource_dir, xcpp::retrieve_cache_dir());
+#endif
+  void* I = nullptr;
+  auto LoadPch = [&ClangArgs](const std::string& Pch) {
+    Args PchArgs = ClangArgs;
+    PchArgs.push_back("-include-pch");
+    PchArgs.push_back(Pch.c_str());
+    // FIXME: We should process the kernel input options and conditionally
+    // pass the gpu args here.
+    return Cpp::CreateInterpreter(PchArgs/*, {"-cuda"}*/);
+  };
+  if (!pch.empty()) {
+    I = LoadPch(pch);
+#ifndef EMSCRIPTEN
+    if (!I) {
+      std::cerr << "The prelude PCH " << pch << " was rejected, rebuilding it\n";
+      pch = xcpp::build_prelude_pch(Options.prelude, ClangArgs, resource_dir, xcpp::retrieve_cache_dir(), true);
+      if (!pch.empty()) {
+        I = LoadPch(pch);
+      }
+    }
+#endif
+    if (!I) {
+      std::cerr << "Failed to load the prelude PCH, including the prelude headers instead\n";
+      pch.clear();
+    }
+  }
+  if (!I) {
+    I = Cpp::CreateInterpreter(ClangArgs/*, {"-cuda"}*/);
+  }
+  if (I && pch.empty()) {
+    for (const std::string& header : Options.prelude) {
+      std::string include = "#include \"" + header + "\"";
+      if (Cpp::Process(include.c_str())) {
+        std::cerr << "Failed to include the prelude header " << header << "\n";
+      }
+    }
+  }
+  // Applied after the prelude: templates of the headers included later by
+  // cells are optnone, and so are their instantiations in %%opt cells.
+  if (I && !OptimizeCells && OptLevel != "0") {
+    Cpp::Process("#pragma clang optimize off");
+  }
+  return I;
 }
 
 using namespace std::placeholders;
 
 namespace xcpp
 {
+#if defined(_WIN32) || defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
     struct StreamRedirectRAII {
       std::string &err;
       StreamRedirectRAII(std::string &e) : err(e) {
@@ -67,6 +169,26 @@ namespace xcpp
         std::cout << out;
       }
     };
+#endif
+
+    static std::string signal_name(int sig)
+    {
+        switch (sig)
+        {
+            case SIGSEGV:
+                return "a segmentation fault (SIGSEGV)";
+            case SIGFPE:
+                return "an arithmetic error (SIGFPE)";
+            case SIGILL:
+                return "an illegal instruction (SIGILL)";
+#ifdef SIGBUS
+            case SIGBUS:
+                return "a bus error (SIGBUS)";
+#endif
+            default:
+                return "signal " + std::to_string(sig);
+        }
+    }
 
     void interpreter::configure_impl()
     {
@@ -76,6 +198,8 @@ namespace xcpp
     static std::string get_stdopt()
     {
         // We need to find what's the C++ version the interpreter runs with.
+        // This JIT compiles a probe, and is only used when the arguments do
+        // not select the standard.
         const char* code = R"(
 int __get_cxx_version () {
 #if __cplusplus > 202302L
@@ -102,21 +226,53 @@ __get_cxx_version ()
 
     interpreter::interpreter(int argc, const char* const* argv) :
         xmagics()
+        , p_doc_catalog(std::make_unique<xdoc_catalog>())
         , p_cout_strbuf(nullptr)
         , p_cerr_strbuf(nullptr)
         , m_cout_buffer(std::bind(&interpreter::publish_stdout, this, _1))
         , m_cerr_buffer(std::bind(&interpreter::publish_stderr, this, _1))
     {
         //NOLINTNEXTLINE (cppcoreguidelines-pro-bounds-pointer-arithmetic)
-        createInterpreter(Args(argv ? argv + 1 : argv, argv + argc));
-        m_version = get_stdopt();
+        Args args(argv ? argv + 1 : argv, argv + argc);
+        kernel_options options = extract_kernel_options(args);
+        m_compile_args.assign(args.begin(), args.end());
+        for (const std::string& header : options.prelude)
+        {
+            m_compile_args.push_back("-include");
+            m_compile_args.push_back(header);
+        }
+        createInterpreter(args, options, m_opt_level, m_optimize_cells);
+        m_allocation_hooks = install_allocation_hooks();
+        m_complete_timeout = std::chrono::milliseconds(options.complete_timeout);
+        m_version = std_version_from_args(args);
+        if (m_version.empty())
+        {
+            m_version = get_stdopt();
+        }
+        if (options.output_flush_interval > 0 || options.output_flush_size > 0)
+        {
+            p_output_publisher = std::make_unique<xoutput_publisher>(
+                std::chrono::milliseconds(options.output_flush_interval > 0 ? options.output_flush_interval : 100),
+                options.output_flush_size > 0 ? options.output_flush_size : 64 * 1024
+            );
+            m_cout_buffer.set_publisher(p_output_publisher.get());
+            m_cerr_buffer.set_publisher(p_output_publisher.get());
+        }
+        if (options.output_limit > 0)
+        {
+            p_output_limit = std::make_unique<xoutput_limit>(options.output_limit);
+        }
         redirect_output();
         init_preamble();
         init_magic();
+        // Map the documentation indices at kernel start rather than on the
+        // first inspect request.
+        p_doc_catalog->sources();
     }
 
     interpreter::~interpreter()
     {
+        get_completion_cache().wait_idle();
         restore_output();
     }
 
@@ -131,6 +287,9 @@ __get_cxx_version ()
         nl::json kernel_res;
 
 
+        // A completion may still be parsing on the worker thread.
+        get_completion_cache().wait_idle();
+
         auto input_guard = input_redirection(config.allow_stdin);
 
         // Check for magics
@@ -139,6 +298,7 @@ __get_cxx_version ()
             if (pre.second.is_match(code))
             {
                 pre.second.apply(code, kernel_res);
+                flush_output();
                 cb(kernel_res);
                 return;
             }
@@ -155,20 +315,36 @@ __get_cxx_version ()
         auto cout_strbuf = std::cout.rdbuf();
         auto cerr_strbuf = std::cerr.rdbuf();
 
+        xnull null;
         if (config.silent)
         {
-            auto null = xnull();
             std::cout.rdbuf(&null);
             std::cerr.rdbuf(&null);
         }
 
         std::string err;
+        int abort_signal = 0;
 
         // Attempt normal evaluation
+        xtransaction_marker marker;
         try
         {
+            const std::string marked = marker.mark(code);
+            auto process = [&compilation_result, &marked]()
+            {
+                compilation_result = Cpp::Process(marked.c_str());
+            };
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+            // Output written to the file descriptors, e.g. by printf, is
+            // forwarded while the cell runs.
+            xfd_capture capture(std::cout.rdbuf(), std::cerr.rdbuf());
+            abort_signal = run_interruptible(process);
+            capture.stop();
+            err = capture.captured_stderr();
+#else
             StreamRedirectRAII R(err);
-            compilation_result = Cpp::Process(code.c_str());
+            abort_signal = run_interruptible(process);
+#endif
         }
         catch (std::exception& e)
         {
@@ -182,17 +358,40 @@ __get_cxx_version ()
             ename = "Error: ";
         }
 
-        if (compilation_result)
+        // Inputs that were parsed are part of the session, even when their
+        // execution failed or was aborted, and %rollback has to undo them
+        // too.
+        if (!compilation_result || marker.kept())
+        {
+            get_journal().record(code, abort_signal == 0 && errorlevel == 0 && !compilation_result);
+        }
+
+        if (abort_signal == SIGINT)
+        {
+            errorlevel = 1;
+            ename = "Interrupted: ";
+            evalue = "Execution of the cell was interrupted";
+        }
+        else if (abort_signal != 0)
+        {
+            errorlevel = 1;
+            ename = "Crash: ";
+            evalue = "The cell was aborted by " + signal_name(abort_signal)
+                     + ", declarations from previous cells are still available";
+        }
+        else if (compilation_result)
         {
             errorlevel = 1;
             ename = "Error: ";
             evalue = "Compilation error! " + err;
+#if defined(_WIN32) || defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+            // The captured diagnostics were already forwarded otherwise.
             std::cerr << err;
+#endif
         }
 
         // Flush streams
-        std::cout << std::flush;
-        std::cerr << std::flush;
+        flush_output();
 
         // Reset non-silent output buffers
         if (config.silent)
@@ -246,47 +445,75 @@ __get_cxx_version ()
 
     nl::json interpreter::complete_request_impl(const std::string& code, int cursor_pos)
     {
-        std::vector<std::string> results;
-
-        // split the input to have only the word in the back of the cursor
-        std::string delims = " \t\n`!@#$^&*()=+[{]}\\|;:\'\",<>?.";
-        std::size_t _cursor_pos = cursor_pos;
-        auto text = split_line(code, delims, _cursor_pos);
-        std::string to_complete = text.back().c_str();
+        // only the word in the back of the cursor is completed
+        static const delimiter_table delims(" \t\n`!@#$^&*()=+[{]}\\|;:\'\",<>?.");
+        std::string to_complete(token_before(code, delims, static_cast<std::size_t>(cursor_pos)));
+
+        // The candidates are computed for the code before the word, and
+        // filtered with the word, so that they are reused while it is typed.
+        std::string context = code.substr(0, cursor_pos - to_complete.length());
+        xcompletion_cache& cache = get_completion_cache();
+        std::vector<std::string> results = cache.complete(context, to_complete, m_complete_timeout);
+
+        // The symbols are only looked up while the worker of the cache
+        // leaves the interpreter alone; they are ranked by match otherwise.
+        const bool lookup = cache.idle();
+        xsymbol_index& index = get_symbol_index();
+        std::vector<completion_item> items = rank_completions(
+            results,
+            to_complete,
+            [&](const std::string& name)
+            {
+                return lookup ? index.describe(context, name) : completion_item{name, "<unknown>", ""};
+            },
+            [&](const std::string& name)
+            {
+                return index.recency(name);
+            }
+        );
 
-        Cpp::CodeComplete(results, code.c_str(), 1, _cursor_pos + 1);
+        const int cursor_start = cursor_pos - static_cast<int>(to_complete.length());
+        nl::json matches = nl::json::array();
+        nl::json types = nl::json::array();
+        for (const completion_item& item : items)
+        {
+            matches.push_back(item.text);
+            types.push_back({
+                {"start", cursor_start},
+                {"end", cursor_pos},
+                {"text", item.text},
+                {"type", item.type},
+                {"signature", item.signature}
+            });
+        }
+        nl::json metadata;
+        metadata["_jupyter_types_experimental"] = std::move(types);
 
-        return xeus::create_complete_reply(results /*matches*/,
-            cursor_pos - to_complete.length() /*cursor_start*/,
-            cursor_pos /*cursor_end*/
+        return xeus::create_complete_reply(matches /*matches*/,
+            cursor_start /*cursor_start*/,
+            cursor_pos /*cursor_end*/,
+            metadata
         );
     }
 
     nl::json interpreter::inspect_request_impl(const std::string& code, int cursor_pos, int /*detail_level*/)
     {
         nl::json kernel_res;
+        get_completion_cache().wait_idle();
         std::string exp = R"(\w*(?:\:{2}|\<.*\>|\(.*\)|\[.*\])?)";
         std::regex re(R"((\w*(?:\:{2}|\<.*\>|\(.*\)|\[.*\])?)(\.?)*$)");
         auto inspect_request = is_inspect_request(code.substr(0, cursor_pos), re);
         if (inspect_request.first)
         {
-            inspect(inspect_request.second[0], kernel_res);
+            inspect(inspect_request.second[0], kernel_res, *p_doc_catalog);
         }
         return kernel_res;
     }
 
     nl::json interpreter::is_complete_request_impl(const std::string& code)
     {
-        if (!code.empty() && code[code.size() - 1] == '\\') {
-            auto found = code.rfind('\n');
-            if (found == std::string::npos)
-                found = -1;
-            auto found1 = found++;
-            while (isspace(code[++found1])) ;
-            return xeus::create_is_complete_reply("incomplete", code.substr(found, found1-found));
-        }
-
-        return xeus::create_is_complete_reply("complete");
+        completeness result = check_completeness(code);
+        return xeus::create_is_complete_reply(result.status, result.indent);
     }
 
     nl::json interpreter::kernel_info_request_impl()
@@ -345,20 +572,58 @@ __get_cxx_version ()
         std::cerr.rdbuf(p_cerr_strbuf);
     }
 
+    void interpreter::prepare_fork()
+    {
+        get_completion_cache().stop();
+        flush_output();
+        if (p_output_publisher)
+        {
+            p_output_publisher->stop();
+        }
+    }
+
+    void interpreter::flush_output()
+    {
+        std::cout << std::flush;
+        std::cerr << std::flush;
+        if (p_output_publisher)
+        {
+            p_output_publisher->flush();
+        }
+        if (p_output_limit)
+        {
+            std::string notice = p_output_limit->reset();
+            if (!notice.empty())
+            {
+                publish_stream("stderr", notice);
+            }
+        }
+    }
+
     void interpreter::publish_stdout(const std::string& s)
     {
+        if (p_output_limit)
+        {
+            p_output_limit->publish(s, [this](const std::string& output) { publish_stream("stdout", output); });
+            return;
+        }
         publish_stream("stdout", s);
     }
 
     void interpreter::publish_stderr(const std::string& s)
     {
+        if (p_output_limit)
+        {
+            p_output_limit->publish(s, [this](const std::string& output) { publish_stream("stderr", output); });
+            return;
+        }
         publish_stream("stderr", s);
     }
 
     void interpreter::init_preamble()
     {
         //NOLINTBEGIN(cppcoreguidelines-owning-memory)
-        preamble_manager.register_preamble("introspection", std::make_unique<xintrospection>());
+        preamble_manager.register_preamble("introspection", std::make_unique<xintrospection>(*p_doc_catalog));
         preamble_manager.register_preamble("magics", std::make_unique<xmagics_manager>());
         preamble_manager.register_preamble("shell", std::make_unique<xsystem>());
         //NOLINTEND(cppcoreguidelines-owning-memory)
@@ -366,12 +631,33 @@ __get_cxx_version ()
 
     void interpreter::init_magic()
     {
-        // preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("executable",
-        // executable(m_interpreter));
-        // preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("timeit",
-        // timeit(&m_interpreter));
         // preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("python", pythonexec());
         preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("file", writefile());
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "asm",
+            codegen(codegen::output_kind::assembly, m_compile_args)
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "llvm",
+            codegen(codegen::output_kind::llvm_ir, m_compile_args)
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("checkpoint", checkpoint());
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("rollback", rollback());
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("timeit", timeit());
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "opt",
+            opt(m_opt_level, m_optimize_cells)
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "executable",
+            executable(m_compile_args)
+        );
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("prof", prof());
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("perfstat", perfstat());
+        preamble_manager["magics"].get_cast<xmagics_manager>().register_magic(
+            "memprof",
+            memprof(m_allocation_hooks)
+        );
 #ifndef EMSCRIPTEN
         preamble_manager["magics"].get_cast<xmagics_manager>().register_magic("xassist", xassist());
 #endif
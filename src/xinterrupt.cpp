@@ -0,0 +1,359 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+#if defined(__linux__)
+#include <link.h>
+#endif
+#include <dlfcn.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <sys/ucontext.h>
+#include <unistd.h>
+#endif
+
+#include "clang/Interpreter/CppInterOp.h"
+
+#include "xeus-cpp/xinterrupt.hpp"
+#include "xeus-cpp/xutils.hpp"
+
+namespace xcpp
+{
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+    namespace
+    {
+        sigjmp_buf cell_env;
+        volatile sig_atomic_t armed = 0;
+        volatile sig_atomic_t pending = 0;
+        // Signal that aborted the cell, returned by run_interruptible.
+        volatile sig_atomic_t abort_signal = 0;
+        pthread_t exec_thread;
+        // Shields of the calling thread: the ones of the threads forwarding
+        // the output must not defer the interrupts of the executing thread.
+        thread_local volatile sig_atomic_t shield_count = 0;
+        int watchdog_pipe[2] = {-1, -1};
+
+        // Executable segments of the loaded objects, taken before each
+        // cell, since nothing looking them up is async-signal-safe. Code
+        // outside of them is JIT compiled code of the cells.
+        struct address_range
+        {
+            std::uintptr_t begin;
+            std::uintptr_t end;
+        };
+
+        constexpr std::size_t max_ranges = 4096;
+        address_range loaded_ranges[max_ranges];
+        std::size_t loaded_range_count = 0;
+
+#if defined(__linux__)
+        int collect_ranges(dl_phdr_info* info, std::size_t, void*)
+        {
+            for (int i = 0; i < info->dlpi_phnum && loaded_range_count < max_ranges; ++i)
+            {
+                const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+                if (phdr.p_type == PT_LOAD && (phdr.p_flags & PF_X) != 0)
+                {
+                    const std::uintptr_t begin = info->dlpi_addr + phdr.p_vaddr;
+                    loaded_ranges[loaded_range_count++] = {begin, begin + phdr.p_memsz};
+                }
+            }
+            return 0;
+        }
+#endif
+
+        void collect_loaded_ranges()
+        {
+            loaded_range_count = 0;
+#if defined(__linux__)
+            dl_iterate_phdr(collect_ranges, nullptr);
+#endif
+        }
+
+        const void* interrupted_pc(void* context)
+        {
+            const auto* uc = static_cast<const ucontext_t*>(context);
+#if defined(__linux__) && defined(__x86_64__)
+            return reinterpret_cast<const void*>(uc->uc_mcontext.gregs[REG_RIP]);
+#elif defined(__linux__) && defined(__aarch64__)
+            return reinterpret_cast<const void*>(uc->uc_mcontext.pc);
+#elif defined(__APPLE__) && defined(__x86_64__)
+            return reinterpret_cast<const void*>(uc->uc_mcontext->__ss.__rip);
+#elif defined(__APPLE__) && defined(__aarch64__)
+            return reinterpret_cast<const void*>(__darwin_arm_thread_state64_get_pc(uc->uc_mcontext->__ss));
+#else
+            (void) uc;
+            return nullptr;
+#endif
+        }
+
+        // Whether `pc` is in JIT compiled code, where the execution can be
+        // abandoned. Anywhere else, such as in libc, libstdc++ or the
+        // compiler, the thread may hold locks or leave a data structure
+        // halfway.
+        bool in_jit_code(const void* pc)
+        {
+            if (pc == nullptr)
+            {
+                return false;
+            }
+            const auto address = reinterpret_cast<std::uintptr_t>(pc);
+            for (std::size_t i = 0; i < loaded_range_count; ++i)
+            {
+                if (address >= loaded_ranges[i].begin && address < loaded_ranges[i].end)
+                {
+                    return false;
+                }
+            }
+            // Objects loaded by the running cell are not in the snapshot.
+            // The loader lock dladdr takes is recursive, and the loader
+            // itself is in the snapshot.
+            Dl_info info;
+            return dladdr(pc, &info) == 0;
+        }
+
+        void defer_interrupt()
+        {
+            if (!pending)
+            {
+                pending = 1;
+                char byte = 0;
+                ssize_t res = ::write(watchdog_pipe[1], &byte, 1);
+                (void) res;
+            }
+        }
+
+        void interrupt_handler(int sig, siginfo_t*, void* context)
+        {
+            if (!armed)
+            {
+                return;
+            }
+            if (!pthread_equal(pthread_self(), exec_thread))
+            {
+                pthread_kill(exec_thread, sig);
+                return;
+            }
+            if (shield_count > 0 || !in_jit_code(interrupted_pc(context)))
+            {
+                defer_interrupt();
+                return;
+            }
+            pending = 0;
+            armed = 0;
+            abort_signal = SIGINT;
+            siglongjmp(cell_env, 1);
+        }
+
+        constexpr int fault_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL};
+        struct sigaction previous_fault_actions[sizeof(fault_signals) / sizeof(int)];
+
+        // Faults outside of the JIT compiled code of the cell are handled as
+        // before, i.e. by xcpp::handler when it is installed: the state of
+        // the process cannot be trusted anymore.
+        void chain_fault(int sig, siginfo_t* info, void* context)
+        {
+            for (std::size_t i = 0; i < sizeof(fault_signals) / sizeof(int); ++i)
+            {
+                if (fault_signals[i] != sig)
+                {
+                    continue;
+                }
+                const struct sigaction& previous = previous_fault_actions[i];
+                if ((previous.sa_flags & SA_SIGINFO) != 0 && previous.sa_sigaction != nullptr)
+                {
+                    previous.sa_sigaction(sig, info, context);
+                    return;
+                }
+                if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN)
+                {
+                    previous.sa_handler(sig);
+                    return;
+                }
+            }
+            signal(sig, SIG_DFL);
+            raise(sig);
+        }
+
+        void fault_handler(int sig, siginfo_t* info, void* context)
+        {
+            // Shielded sections are in xeus-cpp, never in JIT compiled code,
+            // and may be held by the threads forwarding the output.
+            if (!armed || !pthread_equal(pthread_self(), exec_thread) || !in_jit_code(interrupted_pc(context)))
+            {
+                chain_fault(sig, info, context);
+                return;
+            }
+            pending = 0;
+            armed = 0;
+            abort_signal = sig;
+            siglongjmp(cell_env, 1);
+        }
+
+        // Stack overflows are reported on an alternate stack, set up for
+        // each thread running cells.
+        void ensure_alternate_stack()
+        {
+            static thread_local std::vector<char> stack;
+            if (!stack.empty())
+            {
+                return;
+            }
+            stack.resize(std::max<std::size_t>(SIGSTKSZ, 64 * 1024));
+            stack_t alternate;
+            alternate.ss_sp = stack.data();
+            alternate.ss_size = stack.size();
+            alternate.ss_flags = 0;
+            sigaltstack(&alternate, nullptr);
+        }
+
+        // Delivers deferred interrupts again until they land in a place
+        // where the execution can be abandoned.
+        void watchdog()
+        {
+            char byte;
+            while (::read(watchdog_pipe[0], &byte, 1) > 0)
+            {
+                while (pending && armed)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    if (pending && armed)
+                    {
+                        pthread_kill(exec_thread, SIGINT);
+                    }
+                }
+            }
+        }
+    }
+
+    void install_interrupt_handler()
+    {
+        static bool installed = false;
+        if (installed)
+        {
+            return;
+        }
+        installed = true;
+
+        if (::pipe(watchdog_pipe) == 0)
+        {
+            // The watchdog must not handle the interrupts itself.
+            sigset_t all;
+            sigset_t previous;
+            sigfillset(&all);
+            pthread_sigmask(SIG_SETMASK, &all, &previous);
+            std::thread(watchdog).detach();
+            pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+        }
+
+        struct sigaction action;
+        action.sa_sigaction = interrupt_handler;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, nullptr);
+    }
+
+    void install_crash_handler()
+    {
+        static bool installed = false;
+        if (installed)
+        {
+            return;
+        }
+        installed = true;
+
+        struct sigaction action;
+        action.sa_sigaction = fault_handler;
+        action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        for (std::size_t i = 0; i < sizeof(fault_signals) / sizeof(int); ++i)
+        {
+            sigaction(fault_signals[i], &action, &previous_fault_actions[i]);
+        }
+    }
+
+    int run_interruptible(const std::function<void()>& f)
+    {
+        // Nested calls are aborted through the outermost one.
+        if (armed)
+        {
+            f();
+            return 0;
+        }
+
+        exec_thread = pthread_self();
+        // Allocates the thread local storage of the shields, if lazily
+        // allocated, before the handlers may read it.
+        (void) shield_count;
+        ensure_alternate_stack();
+        collect_loaded_ranges();
+        if (sigsetjmp(cell_env, 1) != 0)
+        {
+            return abort_signal;
+        }
+        pending = 0;
+        abort_signal = 0;
+        armed = 1;
+        try
+        {
+            f();
+        }
+        catch (...)
+        {
+            armed = 0;
+            throw;
+        }
+        armed = 0;
+        pending = 0;
+        return 0;
+    }
+
+    void enter_interrupt_shield()
+    {
+        shield_count = shield_count + 1;
+    }
+
+    void leave_interrupt_shield()
+    {
+        shield_count = shield_count - 1;
+    }
+#else
+    void install_interrupt_handler()
+    {
+        signal(SIGINT, stop_handler);
+    }
+
+    void install_crash_handler()
+    {
+    }
+
+    int run_interruptible(const std::function<void()>& f)
+    {
+        f();
+        return 0;
+    }
+
+    void enter_interrupt_shield()
+    {
+    }
+
+    void leave_interrupt_shield()
+    {
+    }
+#endif
+}
@@ -0,0 +1,94 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <atomic>
+#include <string>
+
+#include "clang/Interpreter/CppInterOp.h"
+
+#include "xjournal.hpp"
+
+namespace xcpp
+{
+    void xjournal::record(const std::string& code, bool completed, bool internal)
+    {
+        m_entries.push_back({code, completed, internal});
+        ++m_generation;
+    }
+
+    std::size_t xjournal::size() const
+    {
+        return m_entries.size();
+    }
+
+    const std::vector<xjournal::entry>& xjournal::entries() const
+    {
+        return m_entries;
+    }
+
+    void xjournal::truncate(std::size_t size)
+    {
+        if (size < m_entries.size())
+        {
+            m_entries.resize(size);
+            ++m_generation;
+        }
+    }
+
+    std::size_t xjournal::generation() const
+    {
+        return m_generation;
+    }
+
+    xtransaction_marker::xtransaction_marker()
+    {
+        static std::atomic<unsigned long long> counter(0);
+        m_name = "__xcpp_transaction_" + std::to_string(counter++);
+    }
+
+    std::string xtransaction_marker::mark(const std::string& code) const
+    {
+        return "namespace " + m_name + " {}\n#line 1\n" + code;
+    }
+
+    bool xtransaction_marker::kept() const
+    {
+        return Cpp::GetNamed(m_name) != nullptr;
+    }
+
+    xjournal& get_journal()
+    {
+        static xjournal journal;
+        return journal;
+    }
+
+    std::string journal_source()
+    {
+        std::string source;
+        for (const xjournal::entry& e : get_journal().entries())
+        {
+            if (e.completed && !e.internal)
+            {
+                source += e.code;
+                source += "\n";
+            }
+        }
+        return source;
+    }
+
+    int journal_declare(const std::string& code, bool silent)
+    {
+        xtransaction_marker marker;
+        int res = Cpp::Declare(marker.mark(code).c_str(), silent);
+        if (res == 0 || marker.kept())
+        {
+            get_journal().record(code, res == 0, true);
+        }
+        return res;
+    }
+}
@@ -0,0 +1,100 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_JOURNAL_HPP
+#define XEUS_CPP_JOURNAL_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "xeus-cpp/xeus_cpp_config.hpp"
+
+namespace xcpp
+{
+    /**
+     * Code of the transactions added to the interpreter, in order.
+     *
+     * Each input the interpreter parses successfully becomes a transaction,
+     * which Cpp::Undo can remove again; the journal keeps one entry per
+     * transaction so that the session can be rolled back to a given point.
+     * Entries whose execution was aborted (interrupt, crash, exception) or
+     * failed after parsing (e.g. on an unresolved symbol) are marked as not
+     * completed, and the code generated by the kernel itself as internal.
+     */
+    class XEUS_CPP_API xjournal
+    {
+    public:
+
+        struct entry
+        {
+            std::string code;
+            bool completed;
+            bool internal;
+        };
+
+        void record(const std::string& code, bool completed = true, bool internal = false);
+
+        std::size_t size() const;
+        const std::vector<entry>& entries() const;
+
+        // Drops the entries past the first `size` ones.
+        void truncate(std::size_t size);
+
+        // Changes whenever transactions are added or removed, that is when
+        // the declarations of the session may have changed. This is
+        // deliberately conservative: a transaction without declarations,
+        // e.g. a cell only printing a value, changes it too, since telling
+        // them apart would mean walking the declarations of each one.
+        std::size_t generation() const;
+
+    private:
+
+        std::vector<entry> m_entries;
+        std::size_t m_generation = 0;
+    };
+
+    /**
+     * Tells whether the interpreter kept the transaction of an input.
+     *
+     * Cpp::Process and Cpp::Declare fail both when the input does not parse,
+     * which leaves no transaction, and when it fails later, e.g. when a
+     * symbol cannot be resolved at execution, which keeps it. The input is
+     * processed with the declaration of a unique empty namespace in front
+     * of it, which only exists afterwards if its transaction was kept.
+     */
+    class XEUS_CPP_API xtransaction_marker
+    {
+    public:
+
+        xtransaction_marker();
+
+        // `code` preceded by the marker, with the same line numbers.
+        std::string mark(const std::string& code) const;
+
+        // Whether the transaction of the marked code was kept.
+        bool kept() const;
+
+    private:
+
+        std::string m_name;
+    };
+
+    // Journal of the kernel interpreter.
+    XEUS_CPP_API xjournal& get_journal();
+
+    // Code of the completed inputs of the user, in order, to compile the
+    // session ahead of time.
+    XEUS_CPP_API std::string journal_source();
+
+    // Cpp::Declare for code generated by the kernel, recording the
+    // transaction it adds to the journal as internal.
+    XEUS_CPP_API int journal_declare(const std::string& code, bool silent = true);
+}
+
+#endif
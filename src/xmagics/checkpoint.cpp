@@ -0,0 +1,101 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include "clang/Interpreter/CppInterOp.h"
+
+#include "checkpoint.hpp"
+#include "../xjournal.hpp"
+
+namespace xcpp
+{
+    namespace
+    {
+        // Size of the journal when each checkpoint was taken.
+        std::map<std::string, std::size_t>& checkpoints()
+        {
+            static std::map<std::string, std::size_t> instance;
+            return instance;
+        }
+
+        void get_options(argparser& argpars, const std::string& description)
+        {
+            argpars.add_description(description);
+            argpars.add_argument("name").help("name of the checkpoint").default_value(std::string("default"));
+            // Add custom help (does not call `exit` avoiding to restart the kernel)
+            argpars.add_argument("-h", "--help")
+                .action(
+                    [&](const std::string& /*unused*/)
+                    {
+                        std::cout << argpars.help().str();
+                    }
+                )
+                .default_value(false)
+                .help("shows help message")
+                .implicit_value(true)
+                .nargs(0);
+        }
+    }
+
+    void checkpoint::operator()(const std::string& line)
+    {
+        argparser argpars("checkpoint", XEUS_CPP_VERSION, argparse::default_arguments::none);
+        get_options(argpars, "save the state of the session");
+        argpars.parse(line);
+        if (argpars["-h"] == true)
+        {
+            return;
+        }
+
+        auto name = argpars.get<std::string>("name");
+        checkpoints()[name] = get_journal().size();
+        std::cout << "Checkpoint '" << name << "' saved\n";
+    }
+
+    void rollback::operator()(const std::string& line)
+    {
+        argparser argpars("rollback", XEUS_CPP_VERSION, argparse::default_arguments::none);
+        get_options(argpars, "restore the state of the session saved by %checkpoint");
+        argpars.parse(line);
+        if (argpars["-h"] == true)
+        {
+            return;
+        }
+
+        auto name = argpars.get<std::string>("name");
+        auto& saved = checkpoints();
+        auto it = saved.find(name);
+        if (it == saved.end())
+        {
+            throw std::runtime_error("No checkpoint named '" + name + "'");
+        }
+
+        xjournal& journal = get_journal();
+        const std::size_t target = it->second;
+        const std::size_t count = journal.size() - target;
+        if (count > 0 && Cpp::Undo(static_cast<unsigned>(count)) != 0)
+        {
+            throw std::runtime_error("Failed to undo the cells executed since '" + name + "'");
+        }
+        journal.truncate(target);
+
+        // Checkpoints taken after this one refer to undone inputs.
+        for (auto c = saved.begin(); c != saved.end();)
+        {
+            c = c->second > target ? saved.erase(c) : std::next(c);
+        }
+        std::cout << "Rolled back " << count << " input" << (count == 1 ? "" : "s") << " to checkpoint '"
+                  << name << "'\n";
+    }
+}
@@ -0,0 +1,37 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_CHECKPOINT_MAGIC_HPP
+#define XEUS_CPP_CHECKPOINT_MAGIC_HPP
+
+#include <string>
+
+#include "xeus-cpp/xmagics.hpp"
+#include "xeus-cpp/xoptions.hpp"
+
+namespace xcpp
+{
+    // %checkpoint [name]: remembers the current state of the session.
+    class checkpoint : public xmagic_line
+    {
+    public:
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line) override;
+    };
+
+    // %rollback [name]: undoes the cells executed since the checkpoint.
+    class rollback : public xmagic_line
+    {
+    public:
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line) override;
+    };
+}
+#endif
@@ -0,0 +1,700 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "xeus/xinterpreter.hpp"
+
+#include "xeus-cpp/xutils.hpp"
+
+#include "codegen.hpp"
+#include "../xcompiler.hpp"
+#include "../xjournal.hpp"
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    namespace
+    {
+        // File name the cell is compiled as, through a #line directive, so
+        // that the diagnostics of the cell are told apart from the ones of
+        // the session.
+        const char* cell_file = "cell";
+
+        std::vector<std::string> split_lines(const std::string& text)
+        {
+            std::vector<std::string> lines;
+            std::istringstream iss(text);
+            std::string line;
+            while (std::getline(iss, line))
+            {
+                lines.push_back(line);
+            }
+            return lines;
+        }
+
+        std::string trim(const std::string& s)
+        {
+            std::size_t begin = s.find_first_not_of(" \t\r");
+            if (begin == std::string::npos)
+            {
+                return "";
+            }
+            std::size_t end = s.find_last_not_of(" \t\r");
+            return s.substr(begin, end - begin + 1);
+        }
+
+        std::string unquote(std::string symbol)
+        {
+            if (symbol.size() >= 2 && symbol.front() == '"' && symbol.back() == '"')
+            {
+                symbol = symbol.substr(1, symbol.size() - 2);
+            }
+            return symbol;
+        }
+
+        // Itanium mangled names contain the length of each identifier
+        // before it, e.g. _Z3fooi for foo(int). The length must not be the
+        // end of another one, as 3add in _Z13add_something.
+        bool symbol_matches(const std::string& symbol, const std::string& name)
+        {
+            if (name.empty() || symbol == name || symbol == "_" + name)
+            {
+                return true;
+            }
+            const std::string encoded = std::to_string(name.size()) + name;
+            for (std::size_t pos = symbol.find(encoded); pos != std::string::npos; pos = symbol.find(encoded, pos + 1))
+            {
+                if (pos == 0 || !std::isdigit(static_cast<unsigned char>(symbol[pos - 1])))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Whether `path`, as named in the line tables, is `file`.
+        bool is_file(const std::string& path, const std::string& file)
+        {
+            return path == file
+                   || (path.size() > file.size() && path.compare(path.size() - file.size(), file.size(), file) == 0
+                       && (path[path.size() - file.size() - 1] == '/' || path[path.size() - file.size() - 1] == '\\'));
+        }
+
+        // The quoted strings of a line, e.g. the directory and the name of
+        // a `.file` directive.
+        std::vector<std::string> quoted_strings(const std::string& line)
+        {
+            std::vector<std::string> res;
+            std::size_t begin = line.find('"');
+            while (begin != std::string::npos)
+            {
+                std::size_t end = line.find('"', begin + 1);
+                if (end == std::string::npos)
+                {
+                    break;
+                }
+                res.push_back(line.substr(begin + 1, end - begin - 1));
+                begin = line.find('"', end + 1);
+            }
+            return res;
+        }
+
+        // Number following `directive` at the start of `t`, e.g. the file
+        // of `.loc 1 3 5`, or -1.
+        long directive_number(const std::string& t, const char* directive)
+        {
+            const std::size_t length = std::strlen(directive);
+            if (t.compare(0, length, directive) != 0 || t.size() <= length
+                || !std::isspace(static_cast<unsigned char>(t[length])))
+            {
+                return -1;
+            }
+            std::size_t pos = t.find_first_not_of(" \t", length);
+            if (pos == std::string::npos || !std::isdigit(static_cast<unsigned char>(t[pos])))
+            {
+                return -1;
+            }
+            return std::strtol(t.c_str() + pos, nullptr, 10);
+        }
+
+        bool is_label(const std::string& line)
+        {
+            return !line.empty() && !std::isspace(static_cast<unsigned char>(line[0]))
+                   && trim(line).back() == ':';
+        }
+
+        bool is_local_label(const std::string& line)
+        {
+            // ELF temporary labels start with .L, Mach-O ones with L.
+            for (const char* prefix : {".L", "LBB", "Ltmp", "Lfunc", "LCPI", "Lloh"})
+            {
+                if (line.rfind(prefix, 0) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool is_directive(const std::string& line)
+        {
+            std::string t = trim(line);
+            return !t.empty() && t[0] == '.' && !is_label(line);
+        }
+
+        // Labels only referred to by the line tables.
+        bool is_debug_label(const std::string& line)
+        {
+            for (const char* prefix : {".Ltmp", "Ltmp", ".Lfunc_begin", "Lfunc_begin"})
+            {
+                if (line.rfind(prefix, 0) == 0)
+                {
+                    return is_label(line);
+                }
+            }
+            return false;
+        }
+
+        // Functions are attributed to a file by their first `.loc`
+        // directive, and the files are named by the `.file` directives.
+        std::string extract_assembly(const std::string& code, const std::string& name, const std::string& file)
+        {
+            std::string all;
+            std::string in_file;
+            std::string current;
+            std::vector<std::string> pending;
+            std::string symbol;
+            std::set<long> file_ids;
+            bool has_line_tables = false;
+            long function_file = -1;
+            bool capturing = false;
+            for (const std::string& line : split_lines(code))
+            {
+                std::string t = trim(line);
+                const long file_id = directive_number(t, ".file");
+                if (file_id >= 0)
+                {
+                    const std::vector<std::string> strings = quoted_strings(t);
+                    if (!strings.empty() && is_file(strings.size() > 1 ? strings[1] : strings[0], file))
+                    {
+                        file_ids.insert(file_id);
+                    }
+                    continue;
+                }
+                const long loc_file = directive_number(t, ".loc");
+                if (loc_file >= 0)
+                {
+                    has_line_tables = true;
+                    if (function_file < 0)
+                    {
+                        function_file = loc_file;
+                    }
+                    continue;
+                }
+                if (!capturing)
+                {
+                    if (is_label(line) && !is_local_label(line))
+                    {
+                        symbol = unquote(t.substr(0, t.size() - 1));
+                        pending.assign(1, line);
+                        function_file = -1;
+                    }
+                    else if (t == ".cfi_startproc" || t.rfind(".seh_proc", 0) == 0)
+                    {
+                        capturing = !symbol.empty() && symbol_matches(symbol, name);
+                        if (capturing)
+                        {
+                            current.clear();
+                            for (const std::string& l : pending)
+                            {
+                                if (!is_directive(l) && !is_debug_label(l))
+                                {
+                                    current += l + "\n";
+                                }
+                            }
+                        }
+                        symbol.clear();
+                    }
+                    else if (!symbol.empty())
+                    {
+                        pending.push_back(line);
+                    }
+                    continue;
+                }
+                if (t == ".cfi_endproc" || t == ".seh_endproc"
+                    || (is_label(line) && t.find("func_end") != std::string::npos))
+                {
+                    capturing = false;
+                    current += "\n";
+                    all += current;
+                    if (file_ids.count(function_file) != 0)
+                    {
+                        in_file += current;
+                    }
+                    continue;
+                }
+                if (!is_directive(line) && !is_debug_label(line))
+                {
+                    current += line + "\n";
+                }
+            }
+            return file.empty() || !name.empty() || !has_line_tables ? all : in_file;
+        }
+
+        // Removes the `!dbg` attachments of an IR line.
+        std::string strip_debug_attachments(std::string line)
+        {
+            for (std::size_t pos = line.find(" !dbg !"); pos != std::string::npos; pos = line.find(" !dbg !", pos))
+            {
+                std::size_t begin = pos > 0 && line[pos - 1] == ',' ? pos - 1 : pos;
+                std::size_t end = pos + 7;
+                while (end < line.size() && std::isdigit(static_cast<unsigned char>(line[end])))
+                {
+                    ++end;
+                }
+                line.erase(begin, end - begin);
+                pos = begin;
+            }
+            return line;
+        }
+
+        // Functions are attributed to a file by the DISubprogram attached to
+        // their definition, which is read from the metadata at the end of
+        // the module.
+        std::string extract_llvm_ir(const std::string& code, const std::string& name, const std::string& file)
+        {
+            const std::vector<std::string> lines = split_lines(code);
+            std::set<std::string> file_ids;
+            std::map<std::string, std::string> subprogram_files;
+            for (const std::string& line : lines)
+            {
+                if (line.empty() || line[0] != '!')
+                {
+                    continue;
+                }
+                const std::string id = line.substr(0, line.find(' '));
+                if (line.find("!DIFile(") != std::string::npos)
+                {
+                    const std::size_t filename = line.find("filename: \"");
+                    if (filename != std::string::npos
+                        && is_file(line.substr(filename + 11, line.find('"', filename + 11) - filename - 11), file))
+                    {
+                        file_ids.insert(id);
+                    }
+                }
+                else if (line.find("!DISubprogram(") != std::string::npos)
+                {
+                    const std::size_t ref = line.find(" file: ");
+                    if (ref != std::string::npos)
+                    {
+                        const std::size_t begin = ref + 7;
+                        subprogram_files[id] = line.substr(begin, line.find_first_of(",)", begin) - begin);
+                    }
+                }
+            }
+            const bool filter = !file.empty() && name.empty() && !subprogram_files.empty();
+
+            std::string res;
+            bool capturing = false;
+            for (const std::string& line : lines)
+            {
+                if (!capturing && line.rfind("define ", 0) == 0)
+                {
+                    std::size_t at = line.find('@');
+                    std::size_t paren = line.find('(', at);
+                    capturing = at != std::string::npos && paren != std::string::npos
+                                && symbol_matches(unquote(line.substr(at + 1, paren - at - 1)), name);
+                    if (capturing && filter)
+                    {
+                        const std::size_t dbg = line.find(" !dbg ");
+                        const std::string subprogram = dbg == std::string::npos
+                                                           ? ""
+                                                           : line.substr(dbg + 6, line.find(' ', dbg + 6) - dbg - 6);
+                        auto it = subprogram_files.find(subprogram);
+                        capturing = it != subprogram_files.end() && file_ids.count(it->second) != 0;
+                    }
+                }
+                if (capturing)
+                {
+                    res += strip_debug_attachments(line) + "\n";
+                    if (line == "}")
+                    {
+                        capturing = false;
+                        res += "\n";
+                    }
+                }
+            }
+            return res;
+        }
+
+        std::string html_escape(const std::string& s)
+        {
+            std::string res;
+            res.reserve(s.size());
+            for (char c : s)
+            {
+                switch (c)
+                {
+                    case '&':
+                        res += "&amp;";
+                        break;
+                    case '<':
+                        res += "&lt;";
+                        break;
+                    case '>':
+                        res += "&gt;";
+                        break;
+                    case '"':
+                        res += "&quot;";
+                        break;
+                    default:
+                        res += c;
+                }
+            }
+            return res;
+        }
+
+        std::string span(const char* color, const std::string& text)
+        {
+            return std::string("<span style=\"color:") + color + "\">" + html_escape(text) + "</span>";
+        }
+
+        const char* comment_color = "#6a737d";
+        const char* label_color = "#005cc5";
+        const char* mnemonic_color = "#d73a49";
+        const char* value_color = "#6f42c1";
+        const char* number_color = "#e36209";
+
+        // Offset of the comment of an assembly or IR line, or npos.
+        std::size_t comment_start(const std::string& line, bool llvm_ir)
+        {
+            if (llvm_ir)
+            {
+                return line.find(';');
+            }
+            std::size_t slashes = line.find("//");
+            // '#' starts x86 comments, but also AArch64 immediates (#4).
+            for (std::size_t i = 0; i < line.size() && i < slashes; ++i)
+            {
+                if (line[i] == '#' && (i + 1 == line.size() || std::isspace(static_cast<unsigned char>(line[i + 1]))))
+                {
+                    return i;
+                }
+            }
+            return slashes;
+        }
+
+        std::string highlight_line(const std::string& line, bool llvm_ir)
+        {
+            std::size_t comment = comment_start(line, llvm_ir);
+            std::string code = line.substr(0, comment);
+            std::string res;
+            if (is_label(code))
+            {
+                res = span(label_color, code);
+            }
+            else
+            {
+                bool first_word = true;
+                std::size_t i = 0;
+                while (i < code.size())
+                {
+                    unsigned char c = static_cast<unsigned char>(code[i]);
+                    if (!std::isalnum(c) && c != '_' && c != '.' && c != '%' && c != '@' && c != '$' && c != '#'
+                        && c != '-')
+                    {
+                        res += html_escape(std::string(1, code[i]));
+                        // In IR, the instruction follows the assigned value.
+                        first_word = first_word || (llvm_ir && code[i] == '=');
+                        ++i;
+                        continue;
+                    }
+                    std::size_t end = i;
+                    while (end < code.size())
+                    {
+                        unsigned char d = static_cast<unsigned char>(code[end]);
+                        if (!std::isalnum(d) && d != '_' && d != '.' && d != '%' && d != '@' && d != '$' && d != '#'
+                            && d != '-')
+                        {
+                            break;
+                        }
+                        ++end;
+                    }
+                    std::string word = code.substr(i, end - i);
+                    std::size_t digit = word.find_first_not_of("$#-");
+                    if (word[0] == '%' || word[0] == '@')
+                    {
+                        res += span(value_color, word);
+                    }
+                    else if (digit != std::string::npos && std::isdigit(static_cast<unsigned char>(word[digit])))
+                    {
+                        res += span(number_color, word);
+                    }
+                    else if (first_word)
+                    {
+                        res += span(mnemonic_color, word);
+                    }
+                    else
+                    {
+                        res += html_escape(word);
+                    }
+                    first_word = false;
+                    i = end;
+                }
+            }
+            if (comment != std::string::npos)
+            {
+                res += span(comment_color, line.substr(comment));
+            }
+            return res;
+        }
+
+        struct remark
+        {
+            std::size_t line;
+            std::string kind;
+            std::string message;
+        };
+
+        // Remarks of the cell in the diagnostics of clang, e.g.
+        // cell:3:5: remark: vectorized loop (...) [-Rpass=loop-vectorize]
+        std::vector<remark> parse_remarks(const std::string& diagnostics)
+        {
+            std::vector<remark> res;
+            const std::string prefix = std::string(cell_file) + ":";
+            for (const std::string& line : split_lines(diagnostics))
+            {
+                if (line.rfind(prefix, 0) != 0)
+                {
+                    continue;
+                }
+                std::size_t marker = line.find(": remark: ");
+                if (marker == std::string::npos)
+                {
+                    continue;
+                }
+                remark r;
+                try
+                {
+                    r.line = std::stoul(line.substr(prefix.size()));
+                }
+                catch (const std::exception&)
+                {
+                    continue;
+                }
+                r.message = line.substr(marker + 10);
+                r.kind = r.message.find("[-Rpass-missed=") != std::string::npos     ? "missed"
+                         : r.message.find("[-Rpass-analysis=") != std::string::npos ? "analysis"
+                                                                                     : "passed";
+                res.push_back(r);
+            }
+            return res;
+        }
+
+        void render_remarks(const std::string& cell, const std::vector<remark>& remarks, std::string& text, std::string& html)
+        {
+            std::multimap<std::size_t, const remark*> by_line;
+            for (const remark& r : remarks)
+            {
+                by_line.emplace(r.line, &r);
+            }
+            html += "<pre style=\"border-bottom:1px solid #ddd;padding-bottom:0.5em\">";
+            std::vector<std::string> lines = split_lines(cell);
+            for (std::size_t i = 0; i < lines.size(); ++i)
+            {
+                std::string number = std::to_string(i + 1);
+                number.insert(0, number.size() < 4 ? 4 - number.size() : 0, ' ');
+                text += number + "  " + lines[i] + "\n";
+                html += span(comment_color, number) + "  " + html_escape(lines[i]) + "\n";
+                auto range = by_line.equal_range(i + 1);
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    const remark& r = *it->second;
+                    const char* color = r.kind == "passed" ? "#22863a" : r.kind == "missed" ? "#cb2431" : "#b08800";
+                    text += "      ^ " + r.message + "\n";
+                    html += "      " + span(color, "^ " + r.message) + "\n";
+                }
+            }
+            html += "</pre>";
+            text += "\n";
+        }
+
+        fs::path temporary_path(const std::string& extension)
+        {
+            static unsigned long long counter = 0;
+            auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+            );
+            return fs::temp_directory_path()
+                   / ("xcpp-codegen-" + std::to_string(now.count()) + "-" + std::to_string(counter++) + extension);
+        }
+    }
+
+    std::string extract_function(const std::string& code, const std::string& name, bool llvm_ir, const std::string& file)
+    {
+        return llvm_ir ? extract_llvm_ir(code, name, file) : extract_assembly(code, name, file);
+    }
+
+    std::string highlight_code_html(const std::string& code, bool llvm_ir)
+    {
+        std::string res = "<pre style=\"line-height:1.25\">";
+        for (const std::string& line : split_lines(code))
+        {
+            res += highlight_line(line, llvm_ir) + "\n";
+        }
+        return res + "</pre>";
+    }
+
+    codegen::codegen(output_kind kind, const std::vector<std::string>& compile_args)
+        : m_kind(kind)
+        , m_compile_args(compile_args)
+    {
+    }
+
+    void codegen::operator()(const std::string& line, const std::string& cell)
+    {
+        const bool llvm_ir = m_kind == output_kind::llvm_ir;
+        std::istringstream iss(line);
+        std::string magic;
+        iss >> magic;
+
+        std::string function;
+        std::string level = "-O2";
+        bool remarks = false;
+        std::vector<std::string> flags;
+        std::string token;
+        while (iss >> token)
+        {
+            if (token == "-h" || token == "--help")
+            {
+                std::cout << "Usage: %%" << magic << " [function] [-O<level>] [--remarks] [flags]\n\n"
+                          << "Shows the " << (llvm_ir ? "LLVM IR" : "assembly")
+                          << " of the functions of the cell, or of `function` only.\n"
+                             "--remarks shows the remarks of the loop vectorizer, other flags are passed to\n"
+                             "the compiler, e.g. -march=native.\n";
+                return;
+            }
+            else if (token == "-r" || token == "--remarks")
+            {
+                remarks = true;
+            }
+            else if (token.rfind("-O", 0) == 0)
+            {
+                level = token;
+            }
+            else if (token[0] == '-')
+            {
+                flags.push_back(token);
+            }
+            else if (function.empty())
+            {
+                function = token;
+            }
+            else
+            {
+                throw std::runtime_error(magic + ": unexpected argument " + token);
+            }
+        }
+
+        const std::string clang = find_clang(detect_compiler_paths(retrieve_cache_dir()).resource_dir);
+        if (clang.empty())
+        {
+            throw std::runtime_error(magic + ": no Clang driver found");
+        }
+
+        const fs::path source_file = temporary_path(".cpp");
+        const fs::path output_file = temporary_path(llvm_ir ? ".ll" : ".s");
+        {
+            std::ofstream source(source_file);
+            source << journal_source() << "#line 1 \"" << cell_file << "\"\n" << cell << "\n";
+        }
+
+        std::string command = shell_quote(clang) + " -Xclang -fincremental-extensions";
+        for (const std::string& arg : m_compile_args)
+        {
+            command += " " + shell_quote(arg);
+        }
+        // Without a function, the ones of the cell are told apart with the
+        // line tables, which do not change the generated code.
+        command += " " + shell_quote(level) + (function.empty() ? " -gline-tables-only" : " -g0") + " -S";
+        if (llvm_ir)
+        {
+            command += " -emit-llvm -fno-discard-value-names";
+        }
+        if (remarks)
+        {
+            command += " -Rpass=loop-vectorize -Rpass-missed=loop-vectorize -Rpass-analysis=loop-vectorize";
+        }
+        for (const std::string& flag : flags)
+        {
+            command += " " + shell_quote(flag);
+        }
+        command += " -o " + shell_quote(output_file.string()) + " " + shell_quote(source_file.string());
+
+        std::string diagnostics;
+        int status = run_command(command, diagnostics);
+        std::error_code ec;
+        fs::remove(source_file, ec);
+        if (status != 0)
+        {
+            fs::remove(output_file, ec);
+            std::cerr << diagnostics;
+            throw std::runtime_error(magic + ": compilation failed");
+        }
+
+        std::string output;
+        {
+            std::ifstream in(output_file);
+            std::ostringstream ss;
+            ss << in.rdbuf();
+            output = ss.str();
+        }
+        fs::remove(output_file, ec);
+
+        std::string code = extract_function(output, function, llvm_ir, cell_file);
+        if (trim(code).empty())
+        {
+            throw std::runtime_error(
+                magic + ": no function" + (function.empty() ? std::string() : " matching " + function) + " was generated"
+            );
+        }
+
+        std::string text;
+        std::string html;
+        if (remarks)
+        {
+            render_remarks(cell, parse_remarks(diagnostics), text, html);
+        }
+        text += code;
+        html += highlight_code_html(code, llvm_ir);
+
+        std::cout << std::flush;
+        nl::json data;
+        data["text/plain"] = text;
+        data["text/html"] = html;
+        xeus::get_interpreter().display_data(std::move(data), nl::json::object(), nl::json::object());
+    }
+}
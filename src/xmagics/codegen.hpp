@@ -0,0 +1,68 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_CODEGEN_MAGIC_HPP
+#define XEUS_CPP_CODEGEN_MAGIC_HPP
+
+#include <string>
+#include <vector>
+
+#include "xeus-cpp/xmagics.hpp"
+
+namespace xcpp
+{
+    /**
+     * %%asm [function] [-O<level>] [--remarks] [flags]
+     * %%llvm [function] [-O<level>] [--remarks] [flags]
+     *
+     * Compiles the cell, after the inputs of the session, and displays the
+     * assembly or the LLVM IR of `function` (all the functions when not
+     * given). With --remarks, the optimization remarks of the loop
+     * vectorizer are shown next to the lines of the cell they refer to.
+     */
+    class codegen : public xmagic_cell
+    {
+    public:
+
+        enum class output_kind
+        {
+            assembly,
+            llvm_ir
+        };
+
+        XEUS_CPP_API
+        codegen(output_kind kind, const std::vector<std::string>& compile_args);
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        output_kind m_kind;
+        std::vector<std::string> m_compile_args;
+    };
+
+    // The definition of the functions whose symbol is `name` or whose
+    // mangled symbol contains it, in the output of clang -S (-emit-llvm).
+    // Assembler directives and debug attachments are removed. If `name` is
+    // empty, returns the functions defined in `file` according to the line
+    // tables, or all the functions when `file` is empty or there are no
+    // line tables.
+    XEUS_CPP_API
+    std::string extract_function(
+        const std::string& code,
+        const std::string& name,
+        bool llvm_ir,
+        const std::string& file = ""
+    );
+
+    // HTML rendering of assembly or LLVM IR, with syntax highlighting.
+    XEUS_CPP_API
+    std::string highlight_code_html(const std::string& code, bool llvm_ir);
+}
+#endif
@@ -0,0 +1,154 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "xeus-cpp/xutils.hpp"
+
+#include "executable.hpp"
+#include "../xcompiler.hpp"
+#include "../xjournal.hpp"
+
+namespace fs = std::filesystem;
+
+namespace xcpp
+{
+    namespace
+    {
+        std::string format_size(std::uintmax_t bytes)
+        {
+            static const char* units[] = {"B", "KiB", "MiB", "GiB"};
+            double value = static_cast<double>(bytes);
+            std::size_t unit = 0;
+            while (unit < 3 && value >= 1024)
+            {
+                value /= 1024;
+                ++unit;
+            }
+            std::ostringstream os;
+            os << std::setprecision(3) << value << " " << units[unit];
+            return os.str();
+        }
+    }
+
+    executable::executable(const std::vector<std::string>& compile_args)
+        : m_compile_args(compile_args)
+    {
+    }
+
+    std::string executable::generate_source(const std::string& cell) const
+    {
+        return journal_source() + "int main(int argc, char** argv)\n{\n" + cell + "\n}\n";
+    }
+
+    void executable::operator()(const std::string& line, const std::string& cell)
+    {
+        std::istringstream iss(line);
+        std::string token;
+        // Skips the name of the magic.
+        iss >> token;
+
+        std::string filename;
+        std::vector<std::string> flags;
+        bool in_flags = false;
+        while (iss >> token)
+        {
+            if (in_flags)
+            {
+                flags.push_back(token);
+            }
+            else if (token == "--")
+            {
+                in_flags = true;
+            }
+            else if (token == "-h" || token == "--help")
+            {
+                std::cout << "Usage: %%executable filename [-- flags]\n\n"
+                             "Compiles the declarations of the session and a main function made of the cell\n"
+                             "into an optimized executable. The flags are passed to the compiler, e.g. the\n"
+                             "libraries to link with.\n";
+                return;
+            }
+            else if (filename.empty())
+            {
+                filename = token;
+            }
+            else
+            {
+                throw std::runtime_error("executable: unexpected argument " + token);
+            }
+        }
+        if (filename.empty())
+        {
+            throw std::runtime_error("UsageError: %%executable filename [-- flags]");
+        }
+
+        const std::string clang = find_clang(detect_compiler_paths(retrieve_cache_dir()).resource_dir);
+        if (clang.empty())
+        {
+            throw std::runtime_error("executable: no Clang driver found");
+        }
+
+        fs::path source_file = fs::path(filename);
+        source_file += ".cpp";
+        {
+            std::ofstream source(source_file);
+            source << generate_source(cell);
+            if (!source)
+            {
+                throw std::runtime_error("executable: failed to write " + source_file.string());
+            }
+        }
+
+        // Top level statements of the cells are accepted as they are by the
+        // interpreter, and run before main in the executable.
+        std::string command = shell_quote(clang) + " -Xclang -fincremental-extensions";
+        for (const std::string& arg : m_compile_args)
+        {
+            command += " " + shell_quote(arg);
+        }
+        command += " -O3 -o " + shell_quote(filename) + " " + shell_quote(source_file.string());
+        for (const std::string& flag : flags)
+        {
+            command += " " + shell_quote(flag);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::string output;
+        // LTO needs a linker supporting it, which is not always installed.
+        bool lto = run_command(command + " -flto", output) == 0;
+        if (!lto && run_command(command, output) != 0)
+        {
+            std::cerr << output;
+            throw std::runtime_error("executable: compilation failed, the source is in " + source_file.string());
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << output;
+
+        std::error_code ec;
+        std::uintmax_t size = fs::file_size(filename, ec);
+        std::ostringstream report;
+        report << "Compiled " << filename << (lto ? " with LTO" : " without LTO (unsupported by the linker)")
+               << " in " << std::fixed << std::setprecision(2) << elapsed.count() << " s";
+        if (!ec)
+        {
+            report << ", " << format_size(size);
+        }
+        std::cout << report.str() << std::endl;
+        fs::remove(source_file, ec);
+    }
+}
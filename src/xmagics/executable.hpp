@@ -0,0 +1,47 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_EXECUTABLE_MAGIC_HPP
+#define XEUS_CPP_EXECUTABLE_MAGIC_HPP
+
+#include <string>
+#include <vector>
+
+#include "xeus-cpp/xmagics.hpp"
+
+namespace xcpp
+{
+    /**
+     * %%executable filename [-- flags]
+     *
+     * Compiles the inputs of the session followed by a main function whose
+     * body is the cell into an optimized executable.
+     */
+    class executable : public xmagic_cell
+    {
+    public:
+
+        // `compile_args` are the Clang arguments of the interpreter, which
+        // the executable is compiled with too.
+        XEUS_CPP_API
+        explicit executable(const std::vector<std::string>& compile_args);
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+        // Source of the executable: the completed, non internal entries of
+        // the journal and the main function.
+        XEUS_CPP_API
+        std::string generate_source(const std::string& cell) const;
+
+    private:
+
+        std::vector<std::string> m_compile_args;
+    };
+}
+#endif
@@ -0,0 +1,846 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "clang/Interpreter/CppInterOp.h"
+
+#include "xeus/xinterpreter.hpp"
+
+#include "xeus-cpp/xinterrupt.hpp"
+#include "xeus-cpp/xutils.hpp"
+
+#include "execution.hpp"
+#include "../xcapture.hpp"
+#include "../xallocations.hpp"
+#include "../xcompiler.hpp"
+#include "../xjournal.hpp"
+#include "../xprofiler.hpp"
+
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    namespace
+    {
+        using timed_loop = double (*)(unsigned long long);
+
+        // The benchmarked expression is handed to the sink, whose asm
+        // statement pretends to read it so that the optimizer keeps it.
+        // Void expressions use the built-in comma operator instead.
+        const char* timeit_support = R"(
+#include <chrono>
+struct __xcpp_timeit_sink
+{
+    template <class T>
+    void operator,(T&& value) const
+    {
+        __asm__ __volatile__("" : : "g"(__builtin_addressof(value)) : "memory");
+    }
+};
+)";
+
+        // Splits "timeit -n 10 code" into the options and the code.
+        std::string split_options(const std::string& line, std::string& options)
+        {
+            std::size_t pos = line.find_first_not_of(" \t");
+            pos = line.find_first_of(" \t", pos);
+            bool expect_value = false;
+            while (pos != std::string::npos)
+            {
+                std::size_t begin = line.find_first_not_of(" \t", pos);
+                if (begin == std::string::npos)
+                {
+                    pos = line.size();
+                    break;
+                }
+                std::size_t end = std::min(line.find_first_of(" \t", begin), line.size());
+                std::string token = line.substr(begin, end - begin);
+                if (expect_value)
+                {
+                    expect_value = false;
+                }
+                else if (token == "-n" || token == "-r" || token == "-p")
+                {
+                    expect_value = true;
+                }
+                else if (token != "-h" && token != "--help")
+                {
+                    pos = begin;
+                    break;
+                }
+                pos = end;
+            }
+            pos = std::min(pos, line.size());
+            options = line.substr(0, pos);
+            return line.substr(pos);
+        }
+
+        timed_loop compile_loop(const std::string& setup, const std::string& body, bool expression, bool silent)
+        {
+            static unsigned long long counter = 0;
+            std::string name = "__xcpp_timeit_" + std::to_string(counter++);
+
+            std::ostringstream code;
+            code << "extern \"C\" double " << name << "(unsigned long long __xcpp_loops)\n{\n"
+                 << setup << "\n"
+                 << "auto __xcpp_start = std::chrono::steady_clock::now();\n"
+                 << "for (unsigned long long __xcpp_i = 0; __xcpp_i < __xcpp_loops; ++__xcpp_i)\n{\n";
+            if (expression)
+            {
+                code << "static_cast<void>(__xcpp_timeit_sink{}, (" << body << "\n));\n";
+            }
+            else
+            {
+                code << "{\n" << body << "\n}\n";
+            }
+            code << "__asm__ __volatile__(\"\" : : : \"memory\");\n}\n"
+                 << "return std::chrono::duration<double>(std::chrono::steady_clock::now() - __xcpp_start).count();\n"
+                 << "}\n";
+
+            if (journal_declare(code.str(), silent) != 0)
+            {
+                return nullptr;
+            }
+            // Resolving the address generates the machine code, before
+            // anything is timed.
+            return reinterpret_cast<timed_loop>(Cpp::GetFunctionAddress(Cpp::GetNamed(name)));
+        }
+
+        double run_loop(timed_loop loop, unsigned long long loops)
+        {
+            double elapsed = 0;
+            int abort_signal = run_interruptible(
+                [&]()
+                {
+                    elapsed = loop(loops);
+                }
+            );
+            if (abort_signal == SIGINT)
+            {
+                throw std::runtime_error("timeit: interrupted");
+            }
+            if (abort_signal != 0)
+            {
+                throw std::runtime_error("timeit: the statement crashed with signal " + std::to_string(abort_signal));
+            }
+            return elapsed;
+        }
+
+        std::string format_count(unsigned long long n)
+        {
+            std::string digits = std::to_string(n);
+            for (std::size_t i = digits.size(); i > 3; i -= 3)
+            {
+                digits.insert(i - 3, ",");
+            }
+            return digits;
+        }
+
+        void toggle_counters(void* counters, bool enable)
+        {
+            auto* c = static_cast<xcounters*>(counters);
+            if (enable)
+            {
+                c->enable();
+            }
+            else
+            {
+                c->disable();
+            }
+        }
+
+        using cell_callback = void (*)(void*, bool);
+
+        // Statement of the cell calling `callback(data, flag)` through its
+        // address, which runs once the cell is compiled.
+        std::string callback_statement(cell_callback callback, void* data, bool flag)
+        {
+            std::ostringstream os;
+            os << "((void (*)(void*, bool)) " << reinterpret_cast<std::uintptr_t>(callback) << "ULL)((void*) "
+               << reinterpret_cast<std::uintptr_t>(data) << "ULL, " << (flag ? "true" : "false") << ");\n";
+            return os.str();
+        }
+
+        struct memprof_state
+        {
+            bool running = false;
+            allocation_stats stats = {0, 0, 0, 0, 0, {}};
+        };
+
+        void toggle_allocation_tracking(void* data, bool enable)
+        {
+            auto* state = static_cast<memprof_state*>(data);
+            if (enable)
+            {
+                start_allocation_tracking();
+            }
+            else if (state->running)
+            {
+                state->stats = stop_allocation_tracking();
+            }
+            state->running = enable;
+        }
+
+        std::string format_ratio(double value, std::size_t precision)
+        {
+            std::ostringstream os;
+            os << std::fixed << std::setprecision(static_cast<int>(precision)) << value;
+            return os.str();
+        }
+
+        std::string render_table_text(const std::vector<std::vector<std::string>>& rows)
+        {
+            std::size_t widths[2] = {0, 0};
+            for (const auto& row : rows)
+            {
+                widths[0] = std::max(widths[0], row[0].size());
+                widths[1] = std::max(widths[1], row[1].size());
+            }
+            std::ostringstream os;
+            for (const auto& row : rows)
+            {
+                os << std::right << std::setw(static_cast<int>(widths[1])) << row[1] << "  " << std::left
+                   << std::setw(static_cast<int>(widths[0])) << row[0];
+                if (!row[2].empty())
+                {
+                    os << "  # " << row[2];
+                }
+                os << "\n";
+            }
+            return os.str();
+        }
+
+        std::string html_escape(const std::string& s)
+        {
+            std::string res;
+            for (char c : s)
+            {
+                switch (c)
+                {
+                    case '&':
+                        res += "&amp;";
+                        break;
+                    case '<':
+                        res += "&lt;";
+                        break;
+                    case '>':
+                        res += "&gt;";
+                        break;
+                    default:
+                        res += c;
+                }
+            }
+            return res;
+        }
+
+        std::string render_table_html(const std::vector<std::vector<std::string>>& rows)
+        {
+            std::ostringstream os;
+            os << "<table><thead><tr><th style=\"text-align:left\">event</th><th>count</th>"
+                  "<th style=\"text-align:left\"></th></tr></thead><tbody>";
+            for (const auto& row : rows)
+            {
+                os << "<tr><td style=\"text-align:left\">" << row[0] << "</td><td style=\"text-align:right\">"
+                   << html_escape(row[1]) << "</td><td style=\"text-align:left\">" << row[2] << "</td></tr>";
+            }
+            os << "</tbody></table>";
+            return os.str();
+        }
+    }
+
+    timeit_statistics compute_timeit_statistics(std::vector<double> per_loop)
+    {
+        timeit_statistics stats = {0, 0, 0, 0};
+        if (per_loop.empty())
+        {
+            return stats;
+        }
+        const double n = static_cast<double>(per_loop.size());
+        stats.mean = std::accumulate(per_loop.begin(), per_loop.end(), 0.0) / n;
+        double variance = 0;
+        for (double t : per_loop)
+        {
+            variance += (t - stats.mean) * (t - stats.mean);
+        }
+        stats.stddev = std::sqrt(variance / n);
+
+        std::sort(per_loop.begin(), per_loop.end());
+        const std::size_t middle = per_loop.size() / 2;
+        stats.median = per_loop.size() % 2 == 0 ? (per_loop[middle - 1] + per_loop[middle]) / 2
+                                                : per_loop[middle];
+        stats.min = per_loop.front();
+        return stats;
+    }
+
+    std::string format_timeit_duration(double seconds, std::size_t precision)
+    {
+        static const char* units[] = {"s", "ms", "µs", "ns"};
+        std::size_t unit = 0;
+        double value = seconds;
+        while (unit < 3 && value != 0 && std::abs(value) < 1)
+        {
+            value *= 1000;
+            ++unit;
+        }
+        std::ostringstream os;
+        os << std::setprecision(static_cast<int>(precision)) << value << " " << units[unit];
+        return os.str();
+    }
+
+    void timeit::get_options(argparser& argpars)
+    {
+        argpars.add_description("Time execution of a C++ statement or expression");
+        argpars.add_argument("-n")
+            .help("execute the given statement n times in a loop. If this value is not given, a fitting value is chosen"
+            )
+            .default_value(0)
+            .scan<'i', int>();
+        argpars.add_argument("-r")
+            .help("repeat the loop iteration r times and take the best result")
+            .default_value(7)
+            .scan<'i', int>();
+        argpars.add_argument("-p")
+            .help("use a precision of p digits to display the timing result")
+            .default_value(3)
+            .scan<'i', int>();
+        // Add custom help (does not call `exit` avoiding to restart the kernel)
+        argpars.add_argument("-h", "--help")
+            .action(
+                [&](const std::string& /*unused*/)
+                {
+                    std::cout << argpars.help().str();
+                }
+            )
+            .default_value(false)
+            .help("shows help message")
+            .implicit_value(true)
+            .nargs(0);
+    }
+
+    void timeit::operator()(const std::string& line)
+    {
+        std::string options;
+        std::string code = split_options(line, options);
+        run(options, "", code, true);
+    }
+
+    void timeit::operator()(const std::string& line, const std::string& cell)
+    {
+        std::string options;
+        std::string setup = split_options(line, options);
+        run(options, setup, cell, false);
+    }
+
+    void timeit::run(const std::string& line, const std::string& setup, const std::string& body, bool expression)
+    {
+        argparser argpars("timeit", XEUS_CPP_VERSION, argparse::default_arguments::none);
+        get_options(argpars);
+        argpars.parse(line);
+        if (argpars["-h"] == true)
+        {
+            return;
+        }
+        if (body.find_first_not_of(" \t\n") == std::string::npos)
+        {
+            throw std::runtime_error("UsageError: nothing to time");
+        }
+
+        const int number = argpars.get<int>("-n");
+        const int repeat = std::max(argpars.get<int>("-r"), 1);
+        const int precision = std::max(argpars.get<int>("-p"), 1);
+
+        if (!Cpp::GetNamed("__xcpp_timeit_sink") && journal_declare(timeit_support) != 0)
+        {
+            throw std::runtime_error("timeit: failed to declare the benchmark support code");
+        }
+
+        // A line may hold an expression, whose value must be kept alive, or
+        // a statement such as a declaration.
+        timed_loop loop = expression ? compile_loop(setup, body, true, true) : nullptr;
+        if (loop == nullptr)
+        {
+            loop = compile_loop(setup, body, false, false);
+        }
+        if (loop == nullptr)
+        {
+            throw std::runtime_error("timeit: failed to compile the statement");
+        }
+
+        // Warmup, then calibration: the number of loops grows until a run
+        // takes at least 0.2 s.
+        run_loop(loop, 1);
+        unsigned long long loops = number > 0 ? static_cast<unsigned long long>(number) : 1;
+        if (number <= 0)
+        {
+            for (int i = 0; i < 10 && run_loop(loop, loops) < 0.2; ++i)
+            {
+                loops *= 10;
+            }
+        }
+
+        std::vector<double> per_loop;
+        per_loop.reserve(static_cast<std::size_t>(repeat));
+        for (int i = 0; i < repeat; ++i)
+        {
+            per_loop.push_back(run_loop(loop, loops) / static_cast<double>(loops));
+        }
+
+        const timeit_statistics stats = compute_timeit_statistics(per_loop);
+        const std::size_t p = static_cast<std::size_t>(precision);
+        std::cout << format_timeit_duration(stats.mean, p) << " ± " << format_timeit_duration(stats.stddev, p)
+                  << " per loop (mean ± std. dev. of " << repeat << " run" << (repeat == 1 ? "" : "s") << ", "
+                  << format_count(loops) << " loop" << (loops == 1 ? "" : "s") << " each)\n"
+                  << "median " << format_timeit_duration(stats.median, p) << ", min "
+                  << format_timeit_duration(stats.min, p) << "\n";
+    }
+
+    opt::opt(const std::string& jit_opt_level, bool optimize_cells)
+        : m_jit_opt_level(jit_opt_level)
+        , m_optimize_cells(optimize_cells)
+    {
+    }
+
+    void opt::operator()(const std::string& line, const std::string& cell)
+    {
+        const wrapped_cell wrapped = wrap_cell(line, cell);
+        if (wrapped.code.empty())
+        {
+            return;
+        }
+        if (wrapped.epilogue.empty())
+        {
+            process_cell(wrapped.code);
+            return;
+        }
+        // A fatal error stops the parsing of the cell, the epilogue is an
+        // input of its own so that the pragmas are restored whatever
+        // happens. The journal keeps the whole for %%executable.
+        const std::string source = wrapped.code + "\n" + wrapped.epilogue;
+        try
+        {
+            process_cell(wrapped.code, source);
+        }
+        catch (...)
+        {
+            journal_declare(wrapped.epilogue, false);
+            throw;
+        }
+        journal_declare(wrapped.epilogue, false);
+    }
+
+    opt::wrapped_cell opt::wrap_cell(const std::string& line, const std::string& cell) const
+    {
+        std::istringstream iss(line);
+        std::string token;
+        // Skips the name of the magic.
+        iss >> token;
+
+        std::string level = "2";
+        std::vector<std::string> features;
+        while (iss >> token)
+        {
+            if (token == "-h" || token == "--help")
+            {
+                std::cout << "Usage: %%opt [-O<level>] [-march=<cpu>] [-m<feature>] [-mno-<feature>]\n\n"
+                             "Compiles the cell with optimizations, for the given target CPU and features.\n";
+                return {"", ""};
+            }
+            else if (token.rfind("-O", 0) == 0)
+            {
+                level = token.size() > 2 ? token.substr(2) : "1";
+            }
+            else if (token.rfind("-march=", 0) == 0)
+            {
+                std::string cpu = token.substr(7);
+                if (cpu == "native")
+                {
+                    static const std::string host_cpu = host_cpu_name(
+                        detect_compiler_paths(retrieve_cache_dir()).resource_dir
+                    );
+                    cpu = host_cpu;
+                    if (cpu.empty())
+                    {
+                        throw std::runtime_error("opt: failed to detect the host CPU");
+                    }
+                }
+                features.push_back("arch=" + cpu);
+            }
+            else if (token.rfind("-mno-", 0) == 0)
+            {
+                features.push_back("no-" + token.substr(5));
+            }
+            else if (token.rfind("-m", 0) == 0 && token.size() > 2)
+            {
+                features.push_back(token.substr(2));
+            }
+            else
+            {
+                throw std::runtime_error("opt: unknown option " + token);
+            }
+        }
+
+        const bool optimize = level != "0";
+        if (optimize && m_jit_opt_level == "0")
+        {
+            std::cerr << "opt: the kernel was started without an optimizing pipeline (see --enable-opt-magic), "
+                         "the cell is not optimized\n";
+        }
+        else if (optimize && level != m_jit_opt_level)
+        {
+            std::cerr << "opt: the cell is compiled at the level of the kernel, -O" << m_jit_opt_level << "\n";
+        }
+
+        // The pragma state outlives the cell, the default is restored after
+        // it.
+        std::string prologue;
+        std::string epilogue;
+        if (optimize != m_optimize_cells)
+        {
+            prologue = optimize ? "#pragma clang optimize on\n" : "#pragma clang optimize off\n";
+            epilogue = optimize ? "#pragma clang optimize off\n" : "#pragma clang optimize on\n";
+        }
+        if (!features.empty())
+        {
+            std::string target;
+            for (const std::string& feature : features)
+            {
+                target += (target.empty() ? "" : ",") + feature;
+            }
+            prologue += "#pragma clang attribute push(__attribute__((target(\"" + target
+                        + "\"))), apply_to = function)\n";
+            epilogue = "#pragma clang attribute pop\n" + epilogue;
+        }
+        return {prologue + cell, epilogue};
+    }
+
+    void perfstat::operator()(const std::string& line, const std::string& cell)
+    {
+        std::istringstream iss(line);
+        std::string token;
+        // Skips the name of the magic.
+        iss >> token;
+        while (iss >> token)
+        {
+            if (token == "-h" || token == "--help")
+            {
+                std::cout << "Usage: %%perfstat\n\n"
+                             "Counts the hardware and software events of the execution of the cell.\n";
+                return;
+            }
+            throw std::runtime_error("perfstat: unknown option " + token);
+        }
+#if defined(_WIN32) || defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        (void) cell;
+        throw std::runtime_error("perfstat: performance counters are not supported on this platform");
+#else
+        // The cell enables the counters itself, once it is compiled.
+        xcounters counters;
+        std::string code = callback_statement(&toggle_counters, &counters, true) + cell + "\n;\n"
+                           + callback_statement(&toggle_counters, &counters, false);
+        try
+        {
+            process_cell(code, cell);
+        }
+        catch (...)
+        {
+            counters.disable();
+            throw;
+        }
+        counters.disable();
+
+        std::string note;
+        if (!counters.has_perf_events())
+        {
+            note = "perf_event_open is not permitted, the software events are measured with getrusage.";
+        }
+        else if (!counters.has_hardware_events())
+        {
+            note = "Hardware events are not available, which is common in containers and virtual machines "
+                   "or with a restrictive /proc/sys/kernel/perf_event_paranoid.";
+        }
+
+        const std::vector<std::vector<std::string>> rows = perfstat_rows(counters.read());
+        nl::json data;
+        data["text/plain"] = render_table_text(rows) + (note.empty() ? "" : "\n" + note + "\n");
+        data["text/html"] = render_table_html(rows) + (note.empty() ? "" : "<p>" + note + "</p>");
+        std::cout << std::flush;
+        xeus::get_interpreter().display_data(std::move(data), nl::json::object(), nl::json::object());
+#endif
+    }
+
+    memprof::memprof(bool hooks_installed)
+        : m_hooks_installed(hooks_installed)
+    {
+    }
+
+    void memprof::operator()(const std::string& line, const std::string& cell)
+    {
+        std::istringstream iss(line);
+        std::string token;
+        // Skips the name of the magic.
+        iss >> token;
+        std::size_t top = 10;
+        while (iss >> token)
+        {
+            if (token == "-h" || token == "--help")
+            {
+                std::cout << "Usage: %%memprof [-n count]\n\n"
+                             "Counts the allocations of the execution of the cell, and shows the count\n"
+                             "functions allocating the most bytes, 10 by default.\n";
+                return;
+            }
+            else if (token == "-n" && iss >> token)
+            {
+                try
+                {
+                    top = static_cast<std::size_t>(std::stoul(token));
+                }
+                catch (const std::exception&)
+                {
+                    throw std::runtime_error("memprof: invalid count " + token);
+                }
+            }
+            else
+            {
+                throw std::runtime_error("memprof: unknown option " + token);
+            }
+        }
+#if defined(_WIN32) || defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        (void) cell;
+        throw std::runtime_error("memprof: allocation tracking is not supported on this platform");
+#else
+        if (!m_hooks_installed)
+        {
+            throw std::runtime_error("memprof: the allocation functions of the JIT could not be hooked");
+        }
+
+        // The cell starts the tracking itself, once it is compiled.
+        memprof_state state;
+        std::string code = callback_statement(&toggle_allocation_tracking, &state, true) + cell + "\n;\n"
+                           + callback_statement(&toggle_allocation_tracking, &state, false);
+        try
+        {
+            process_cell(code, cell);
+        }
+        catch (...)
+        {
+            toggle_allocation_tracking(&state, false);
+            throw;
+        }
+        toggle_allocation_tracking(&state, false);
+        const allocation_stats& stats = state.stats;
+
+        // Call sites are grouped by the function they belong to.
+        xsymbolizer symbols;
+        std::map<std::string, std::pair<std::size_t, std::size_t>> functions;
+        for (const allocation_site& site : stats.sites)
+        {
+            auto& f = functions[symbols.name(static_cast<char*>(site.address) - 1)];
+            f.first += site.count;
+            f.second += site.bytes;
+        }
+        std::vector<std::pair<std::string, std::pair<std::size_t, std::size_t>>> ranked(
+            functions.begin(),
+            functions.end()
+        );
+        std::sort(
+            ranked.begin(),
+            ranked.end(),
+            [](const auto& lhs, const auto& rhs)
+            {
+                return lhs.second.second > rhs.second.second;
+            }
+        );
+        ranked.resize(std::min(ranked.size(), top));
+
+        const std::string live = stats.live_bytes < 0
+                                     ? "-" + format_bytes(static_cast<std::size_t>(-stats.live_bytes))
+                                     : format_bytes(static_cast<std::size_t>(stats.live_bytes));
+        std::ostringstream text;
+        text << format_count(stats.allocations) << " allocations, " << format_count(stats.frees) << " frees\n"
+             << format_bytes(stats.bytes) << " allocated, peak " << format_bytes(stats.peak_bytes) << " live, "
+             << live << " still live at the end\n";
+        std::ostringstream html;
+        html << "<p>" << format_count(stats.allocations) << " allocations, " << format_count(stats.frees)
+             << " frees<br>" << format_bytes(stats.bytes) << " allocated, peak " << format_bytes(stats.peak_bytes)
+             << " live, " << live << " still live at the end</p>";
+        if (!ranked.empty())
+        {
+            text << "\n" << std::setw(12) << "allocations" << std::setw(14) << "bytes" << "  function\n";
+            html << "<table><thead><tr><th style=\"text-align:left\">function</th><th>allocations</th>"
+                    "<th>bytes</th></tr></thead><tbody>";
+            for (const auto& f : ranked)
+            {
+                text << std::setw(12) << format_count(f.second.first) << std::setw(14)
+                     << format_bytes(f.second.second) << "  " << f.first << "\n";
+                html << "<tr><td style=\"text-align:left\"><code>" << html_escape(f.first)
+                     << "</code></td><td style=\"text-align:right\">" << format_count(f.second.first)
+                     << "</td><td style=\"text-align:right\">" << format_bytes(f.second.second) << "</td></tr>";
+            }
+            html << "</tbody></table>";
+        }
+
+        nl::json data;
+        data["text/plain"] = text.str();
+        data["text/html"] = html.str();
+        std::cout << std::flush;
+        xeus::get_interpreter().display_data(std::move(data), nl::json::object(), nl::json::object());
+#endif
+    }
+
+    std::string format_bytes(std::size_t bytes)
+    {
+        if (bytes < 1024)
+        {
+            return std::to_string(bytes) + " B";
+        }
+        const char* units[] = {"KiB", "MiB", "GiB", "TiB"};
+        double value = static_cast<double>(bytes) / 1024;
+        std::size_t unit = 0;
+        while (value >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0]))
+        {
+            value /= 1024;
+            ++unit;
+        }
+        return format_ratio(value, 2) + " " + units[unit];
+    }
+
+    std::vector<std::vector<std::string>> perfstat_rows(const std::vector<counter_reading>& readings)
+    {
+        std::map<std::string, double> counted;
+        for (const counter_reading& r : readings)
+        {
+            if (r.supported && r.running > 0)
+            {
+                counted[r.name] = r.value;
+            }
+        }
+        // Metric of `event` relative to `base`, when both were counted.
+        auto ratio = [&counted](const std::string& event, const std::string& base, double& res)
+        {
+            auto e = counted.find(event);
+            auto b = counted.find(base);
+            if (e == counted.end() || b == counted.end() || b->second <= 0)
+            {
+                return false;
+            }
+            res = e->second / b->second;
+            return true;
+        };
+
+        std::vector<std::vector<std::string>> rows;
+        for (const counter_reading& r : readings)
+        {
+            std::string value;
+            std::string metric;
+            double x = 0;
+            if (!r.supported)
+            {
+                value = "<not supported>";
+            }
+            else if (r.running <= 0)
+            {
+                value = "<not counted>";
+            }
+            else if (r.name == "task-clock")
+            {
+                value = format_ratio(r.value / 1e6, 2) + " ms";
+            }
+            else
+            {
+                value = format_count(static_cast<unsigned long long>(std::llround(r.value)));
+            }
+
+            if (r.name == "instructions" && ratio("instructions", "cycles", x))
+            {
+                metric = format_ratio(x, 2) + " insn per cycle";
+            }
+            else if (r.name == "branch-misses" && ratio("branch-misses", "branches", x))
+            {
+                metric = format_ratio(100 * x, 2) + "% of all branches";
+            }
+            else if (r.name == "L1-dcache-load-misses" && ratio("L1-dcache-load-misses", "L1-dcache-loads", x))
+            {
+                metric = format_ratio(100 * x, 2) + "% of all L1-dcache accesses";
+            }
+            else if (r.name == "LLC-load-misses" && ratio("LLC-load-misses", "LLC-loads", x))
+            {
+                metric = format_ratio(100 * x, 2) + "% of all LL-cache accesses";
+            }
+            // Share of the time the event was counted, when multiplexed.
+            if (r.supported && r.running > 0 && r.running < 0.9999)
+            {
+                metric += (metric.empty() ? "(" : " (") + format_ratio(100 * r.running, 2) + "%)";
+            }
+            rows.push_back({r.name, value, metric});
+        }
+        return rows;
+    }
+
+    void process_cell(const std::string& code)
+    {
+        process_cell(code, code);
+    }
+
+    void process_cell(const std::string& code, const std::string& source)
+    {
+        bool failed = false;
+        int abort_signal = 0;
+        xtransaction_marker marker;
+        try
+        {
+            const std::string marked = marker.mark(code);
+            auto process = [&failed, &marked]()
+            {
+                failed = Cpp::Process(marked.c_str()) != 0;
+            };
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+            xfd_capture capture(std::cout.rdbuf(), std::cerr.rdbuf());
+#endif
+            abort_signal = run_interruptible(process);
+        }
+        catch (...)
+        {
+            get_journal().record(source, false);
+            throw;
+        }
+
+        if (failed)
+        {
+            if (marker.kept())
+            {
+                get_journal().record(source, false);
+            }
+            throw std::runtime_error("Compilation error!");
+        }
+        get_journal().record(source, abort_signal == 0);
+        if (abort_signal == SIGINT)
+        {
+            throw std::runtime_error("Execution of the cell was interrupted");
+        }
+        if (abort_signal != 0)
+        {
+            throw std::runtime_error("The cell was aborted by signal " + std::to_string(abort_signal));
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_EXECUTION_MAGIC_HPP
+#define XEUS_CPP_EXECUTION_MAGIC_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "xeus-cpp/xmagics.hpp"
+#include "xeus-cpp/xoptions.hpp"
+
+#include "../xcounters.hpp"
+
+namespace xcpp
+{
+    /**
+     * %timeit [-n N] [-r R] [-p P] expression
+     * %%timeit [-n N] [-r R] [-p P] [setup]
+     *
+     * The statement is compiled once into a function running it in a loop,
+     * which measures its own duration so that neither the compilation nor
+     * the setup are timed.
+     */
+    class timeit : public xmagic_line_cell
+    {
+    public:
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line) override;
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        void get_options(argparser& argpars);
+        void run(const std::string& line, const std::string& setup, const std::string& body, bool expression);
+    };
+
+    /**
+     * %%opt [-O<level>] [-march=<cpu>] [-m<feature>] [-mno-<feature>]
+     *
+     * Compiles the cell with the optimizing pipeline of the JIT, whatever
+     * the default level of the cells, and for the given target CPU and
+     * features.
+     */
+    class opt : public xmagic_cell
+    {
+    public:
+
+        // `jit_opt_level` is the level of the pipeline the interpreter was
+        // created with, `optimize_cells` whether the other cells use it.
+        XEUS_CPP_API
+        opt(const std::string& jit_opt_level, bool optimize_cells);
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+        struct wrapped_cell
+        {
+            // The cell preceded by the pragmas implementing the options,
+            // empty if there is nothing to run.
+            std::string code;
+            // The pragmas restoring the defaults after the cell.
+            std::string epilogue;
+        };
+
+        XEUS_CPP_API
+        wrapped_cell wrap_cell(const std::string& line, const std::string& cell) const;
+
+    private:
+
+        std::string m_jit_opt_level;
+        bool m_optimize_cells;
+    };
+
+    /**
+     * %%perfstat
+     *
+     * Counts the hardware and software events of the execution of the cell,
+     * compilation excluded, like perf stat.
+     */
+    class perfstat : public xmagic_cell
+    {
+    public:
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+    };
+
+    /**
+     * %%memprof [-n count]
+     *
+     * Counts the allocations made by the cell, and shows the functions of
+     * the session allocating the most.
+     */
+    class memprof : public xmagic_cell
+    {
+    public:
+
+        // `hooks_installed` tells whether install_allocation_hooks
+        // succeeded.
+        XEUS_CPP_API
+        explicit memprof(bool hooks_installed);
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+
+    private:
+
+        bool m_hooks_installed;
+    };
+
+    // Formats a size in bytes with binary units, e.g. 1.50 KiB.
+    XEUS_CPP_API std::string format_bytes(std::size_t bytes);
+
+    // Rows of the %%perfstat table: the event, its count and the metrics
+    // derived from it, such as the instructions per cycle.
+    XEUS_CPP_API std::vector<std::vector<std::string>> perfstat_rows(const std::vector<counter_reading>& readings);
+
+    // Executes `code` from a magic as a regular cell would be: the output
+    // written to the file descriptors is forwarded, the execution can be
+    // interrupted and the input is recorded in the journal. Throws
+    // std::runtime_error if the code does not compile or is aborted.
+    XEUS_CPP_API void process_cell(const std::string& code);
+
+    // Same as above, recording `source` in the journal instead of `code`,
+    // for code that is only valid during this execution.
+    XEUS_CPP_API void process_cell(const std::string& code, const std::string& source);
+
+    struct timeit_statistics
+    {
+        double mean;
+        double median;
+        double stddev;
+        double min;
+    };
+
+    // Statistics of the durations of one loop, measured over several runs.
+    XEUS_CPP_API timeit_statistics compute_timeit_statistics(std::vector<double> per_loop);
+
+    // Formats a duration in seconds with the most readable unit, e.g. 1.23 ms.
+    XEUS_CPP_API std::string format_timeit_duration(double seconds, std::size_t precision);
+}
+#endif
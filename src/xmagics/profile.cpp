@@ -0,0 +1,247 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "xeus/xinterpreter.hpp"
+
+#include "profile.hpp"
+#include "execution.hpp"
+#include "../xprofiler.hpp"
+
+namespace fs = std::filesystem;
+namespace nl = nlohmann;
+
+namespace xcpp
+{
+    namespace
+    {
+        struct prof_options
+        {
+            std::size_t interval_us = 1000;
+            bool perf_map = false;
+            bool jitdump = false;
+            std::string jitdump_dir;
+        };
+
+        bool parse_options(const std::string& line, prof_options& options)
+        {
+            std::istringstream iss(line);
+            std::vector<std::string> tokens;
+            std::string token;
+            while (iss >> token)
+            {
+                tokens.push_back(token);
+            }
+            // Skips the name of the magic.
+            for (std::size_t i = 1; i < tokens.size(); ++i)
+            {
+                if (tokens[i] == "-h" || tokens[i] == "--help")
+                {
+                    std::cout << "Usage: %%prof [-i interval_us] [--perf-map] [--jitdump [dir]]\n\n"
+                                 "Executes the cell under a sampling profiler and displays its flame graph.\n\n"
+                                 "  -i interval_us   CPU time between two samples, 1000 by default\n"
+                                 "  --perf-map       writes /tmp/perf-<pid>.map for perf report\n"
+                                 "  --jitdump [dir]  writes jit-<pid>.dump for perf inject --jit\n";
+                    return false;
+                }
+                else if (tokens[i] == "-i" && i + 1 < tokens.size())
+                {
+                    try
+                    {
+                        options.interval_us = static_cast<std::size_t>(std::stoul(tokens[++i]));
+                    }
+                    catch (const std::exception&)
+                    {
+                        throw std::runtime_error("prof: invalid interval " + tokens[i]);
+                    }
+                    if (options.interval_us == 0)
+                    {
+                        throw std::runtime_error("prof: the interval must be positive");
+                    }
+                }
+                else if (tokens[i] == "--perf-map")
+                {
+                    options.perf_map = true;
+                }
+                else if (tokens[i] == "--jitdump")
+                {
+                    options.jitdump = true;
+                    if (i + 1 < tokens.size() && tokens[i + 1][0] != '-')
+                    {
+                        options.jitdump_dir = tokens[++i];
+                    }
+                }
+                else
+                {
+                    throw std::runtime_error("prof: unknown option " + tokens[i]);
+                }
+            }
+            return true;
+        }
+
+        std::string format_percent(std::size_t count, std::size_t total)
+        {
+            std::ostringstream os;
+            os << std::fixed << std::setprecision(1)
+               << 100.0 * static_cast<double>(count) / static_cast<double>(total) << "%";
+            return os.str();
+        }
+
+        // Text summary: the functions with the most samples, by self and
+        // total count.
+        std::string summarize(const folded_stacks& stacks, std::size_t total, std::size_t dropped)
+        {
+            std::map<std::string, std::size_t> self;
+            std::map<std::string, std::size_t> inclusive;
+            for (const auto& stack : stacks)
+            {
+                self[stack.first.back()] += stack.second;
+                std::vector<std::string> seen;
+                for (const std::string& frame : stack.first)
+                {
+                    if (std::find(seen.begin(), seen.end(), frame) == seen.end())
+                    {
+                        inclusive[frame] += stack.second;
+                        seen.push_back(frame);
+                    }
+                }
+            }
+
+            std::vector<std::pair<std::string, std::size_t>> ranked(self.begin(), self.end());
+            std::sort(
+                ranked.begin(),
+                ranked.end(),
+                [](const auto& lhs, const auto& rhs)
+                {
+                    return lhs.second > rhs.second;
+                }
+            );
+
+            std::ostringstream os;
+            os << total << " samples";
+            if (dropped > 0)
+            {
+                os << " (" << dropped << " dropped)";
+            }
+            os << "\n\n" << std::setw(8) << "self" << std::setw(8) << "total" << "  function\n";
+            for (std::size_t i = 0; i < std::min<std::size_t>(ranked.size(), 15); ++i)
+            {
+                os << std::setw(8) << format_percent(ranked[i].second, total) << std::setw(8)
+                   << format_percent(inclusive[ranked[i].first], total) << "  " << ranked[i].first << "\n";
+            }
+            return os.str();
+        }
+    }
+
+    void prof::operator()(const std::string& line, const std::string& cell)
+    {
+#if defined(_WIN32) || defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+        (void) line;
+        (void) cell;
+        throw std::runtime_error("prof: profiling is not supported on this platform");
+#else
+        prof_options options;
+        if (!parse_options(line, options))
+        {
+            return;
+        }
+
+        xprofiler profiler(options.interval_us);
+        if (!profiler.start())
+        {
+            throw std::runtime_error("prof: failed to start the profiler");
+        }
+        try
+        {
+            process_cell(cell);
+        }
+        catch (...)
+        {
+            profiler.stop();
+            throw;
+        }
+        profiler.stop();
+
+        // Samples taken while compiling the cell have no JIT compiled frame
+        // and are left out, as well as the frames of the interpreter calling
+        // into the cell.
+        xsymbolizer symbols;
+        folded_stacks stacks;
+        std::size_t total = 0;
+        for (const std::vector<void*>& sample : profiler.samples())
+        {
+            std::size_t outermost = sample.size();
+            for (std::size_t i = 0; i < sample.size(); ++i)
+            {
+                if (symbols.is_jit(sample[i]))
+                {
+                    outermost = i;
+                }
+            }
+            if (outermost == sample.size())
+            {
+                continue;
+            }
+            std::vector<std::string> stack;
+            for (std::size_t i = outermost + 1; i-- > 0;)
+            {
+                // Return addresses point after the call, which may be the
+                // start of the next function.
+                void* address = i == 0 ? sample[i] : static_cast<char*>(sample[i]) - 1;
+                std::string name = symbols.name(address);
+                if (i == outermost && name.rfind("[jit]", 0) == 0)
+                {
+                    name = "cell";
+                }
+                stack.push_back(std::move(name));
+            }
+            ++stacks[stack];
+            ++total;
+        }
+
+        if (options.perf_map)
+        {
+            std::string path = write_perf_map(symbols.jit_functions());
+            std::cout << (path.empty() ? "prof: failed to write the perf map" : "Wrote " + path) << "\n";
+        }
+        if (options.jitdump)
+        {
+            std::string dir = options.jitdump_dir.empty() ? fs::temp_directory_path().string()
+                                                          : options.jitdump_dir;
+            std::string path = write_jitdump(symbols.jit_functions(), dir);
+            std::cout << (path.empty() ? "prof: failed to write the jitdump file" : "Wrote " + path) << "\n";
+        }
+
+        if (total == 0)
+        {
+            std::cout << "prof: no samples in the cell, it ran for less than the interval" << std::endl;
+            return;
+        }
+
+        nl::json data;
+        data["text/plain"] = summarize(stacks, total, profiler.dropped());
+        data["text/html"] = "<div style=\"overflow-x:auto\">"
+                            + render_flame_graph(stacks, std::to_string(total) + " samples") + "</div>";
+        std::cout << std::flush;
+        xeus::get_interpreter().display_data(std::move(data), nl::json::object(), nl::json::object());
+#endif
+    }
+}
@@ -0,0 +1,32 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_PROFILE_MAGIC_HPP
+#define XEUS_CPP_PROFILE_MAGIC_HPP
+
+#include <string>
+
+#include "xeus-cpp/xmagics.hpp"
+
+namespace xcpp
+{
+    /**
+     * %%prof [-i interval_us] [--perf-map] [--jitdump [dir]]
+     *
+     * Executes the cell under a sampling profiler and displays the flame
+     * graph of the JIT compiled code it ran.
+     */
+    class prof : public xmagic_cell
+    {
+    public:
+
+        XEUS_CPP_API
+        virtual void operator()(const std::string& line, const std::string& cell) override;
+    };
+}
+#endif
@@ -7,9 +7,14 @@
  * The full license is in the file LICENSE, distributed with this software.         *
  ************************************************************************************/
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
 #include <iterator>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "xeus-cpp/xoptions.hpp"
@@ -43,4 +48,188 @@ namespace xcpp
             std::cerr << err.what() << std::endl;
         }
     }
+
+    namespace
+    {
+        // Matches `--name value` and `--name=value`, advancing `i` past the
+        // consumed arguments.
+        bool match_option(
+            const std::vector<const char*>& args,
+            std::size_t& i,
+            const char* name,
+            std::string& value
+        )
+        {
+            const std::size_t length = std::strlen(name);
+            if (std::strncmp(args[i], name, length) != 0)
+            {
+                return false;
+            }
+            if (args[i][length] == '=')
+            {
+                value = args[i] + length + 1;
+                ++i;
+                return true;
+            }
+            if (args[i][length] == '\0' && i + 1 < args.size())
+            {
+                value = args[i + 1];
+                i += 2;
+                return true;
+            }
+            return false;
+        }
+
+        std::size_t parse_size(const char* name, const std::string& value)
+        {
+            try
+            {
+                std::size_t pos = 0;
+                unsigned long long res = std::stoull(value, &pos);
+                if (pos == value.size())
+                {
+                    return static_cast<std::size_t>(res);
+                }
+            }
+            catch (const std::exception&)
+            {
+            }
+            std::cerr << "Ignoring invalid value for " << name << ": " << value << std::endl;
+            return 0;
+        }
+    }
+
+    kernel_options extract_kernel_options(std::vector<const char*>& args)
+    {
+        kernel_options options;
+        std::vector<const char*> remaining;
+        remaining.reserve(args.size());
+
+        std::size_t i = 0;
+        while (i < args.size())
+        {
+            std::string value;
+            if (match_option(args, i, "--prelude", value))
+            {
+                options.prelude.push_back(value);
+            }
+            else if (std::strcmp(args[i], "--rediscover-compiler-paths") == 0)
+            {
+                options.rediscover_compiler_paths = true;
+                ++i;
+            }
+            else if (std::strcmp(args[i], "--enable-opt-magic") == 0)
+            {
+                options.enable_opt_magic = true;
+                ++i;
+            }
+            else if (match_option(args, i, "--output-flush-interval", value))
+            {
+                options.output_flush_interval = parse_size("--output-flush-interval", value);
+            }
+            else if (match_option(args, i, "--output-flush-size", value))
+            {
+                options.output_flush_size = parse_size("--output-flush-size", value);
+            }
+            else if (match_option(args, i, "--output-limit", value))
+            {
+                options.output_limit = parse_size("--output-limit", value);
+            }
+            else if (match_option(args, i, "--complete-timeout", value))
+            {
+                options.complete_timeout = parse_size("--complete-timeout", value);
+            }
+            else if (match_option(args, i, "--jit-opt-level", value))
+            {
+                static const char* levels[] = {"0", "1", "2", "3", "s", "z"};
+                if (std::find(std::begin(levels), std::end(levels), value) != std::end(levels))
+                {
+                    options.jit_opt_level = value;
+                }
+                else
+                {
+                    std::cerr << "Ignoring invalid value for --jit-opt-level: " << value << std::endl;
+                }
+            }
+            else
+            {
+                remaining.push_back(args[i]);
+                ++i;
+            }
+        }
+
+        args = std::move(remaining);
+        return options;
+    }
+
+    std::string std_version_from_args(const std::vector<const char*>& args)
+    {
+        // The last flag wins, as it does for the Clang driver.
+        std::string standard;
+        for (std::size_t i = 0; i < args.size(); ++i)
+        {
+            std::string arg = args[i];
+            for (const char* prefix : {"-std=", "--std="})
+            {
+                if (arg.rfind(prefix, 0) == 0)
+                {
+                    standard = arg.substr(std::strlen(prefix));
+                }
+            }
+            if (arg == "--std" && i + 1 < args.size())
+            {
+                standard = args[++i];
+            }
+        }
+
+        // C standards, e.g. -std=c17 with -xc, do not select a C++ version.
+        bool is_cpp = false;
+        for (const char* prefix : {"c++", "gnu++"})
+        {
+            if (standard.rfind(prefix, 0) == 0)
+            {
+                standard = standard.substr(std::strlen(prefix));
+                is_cpp = true;
+                break;
+            }
+        }
+        if (!is_cpp)
+        {
+            return "";
+        }
+
+        static const std::pair<const char*, const char*> versions[] = {
+            {"11", "11"}, {"0x", "11"},
+            {"14", "14"}, {"1y", "14"},
+            {"17", "17"}, {"1z", "17"},
+            {"20", "20"}, {"2a", "20"},
+            {"23", "23"}, {"2b", "23"},
+            {"26", "26"}, {"2c", "26"}
+        };
+        for (const auto& version : versions)
+        {
+            if (standard == version.first)
+            {
+                return version.second;
+            }
+        }
+        return "";
+    }
+
+    std::string opt_level_from_args(const std::vector<const char*>& args)
+    {
+        std::string level;
+        for (const char* arg : args)
+        {
+            if (arg[0] == '-' && arg[1] == 'O')
+            {
+                level = arg + 2;
+                if (level.empty())
+                {
+                    level = "1";
+                }
+            }
+        }
+        return level;
+    }
 }
@@ -9,14 +9,70 @@
 
 #include "xparser.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <cstddef>
-#include <regex>
-#include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace xcpp
 {
+    namespace
+    {
+        bool is_identifier_char(char c)
+        {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        }
+
+        bool is_blank(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+        }
+
+        // Leading whitespace of the line containing `pos`.
+        std::string line_indent(std::string_view code, std::size_t pos)
+        {
+            std::size_t begin = pos == 0 ? std::string_view::npos : code.rfind('\n', pos - 1);
+            begin = begin == std::string_view::npos ? 0 : begin + 1;
+            std::size_t end = begin;
+            while (end < code.size() && (code[end] == ' ' || code[end] == '\t'))
+            {
+                ++end;
+            }
+            return std::string(code.substr(begin, end - begin));
+        }
+
+        // Position past the string or character literal starting at `pos`,
+        // or npos if it is not closed on its line.
+        std::size_t skip_quoted(std::string_view code, std::size_t pos)
+        {
+            const char quote = code[pos];
+            for (std::size_t i = pos + 1; i < code.size(); ++i)
+            {
+                if (code[i] == '\\')
+                {
+                    ++i;
+                }
+                else if (code[i] == quote)
+                {
+                    return i + 1;
+                }
+                else if (code[i] == '\n')
+                {
+                    break;
+                }
+            }
+            return std::string_view::npos;
+        }
+
+        bool is_raw_string_prefix(std::string_view identifier)
+        {
+            return identifier == "R" || identifier == "u8R" || identifier == "uR" || identifier == "UR"
+                   || identifier == "LR";
+        }
+    }
+
     std::string trim(const std::string& str)
     {
         if (str.empty())
@@ -30,28 +86,272 @@ namespace xcpp
         return str.substr(first, last - first + 1);
     }
 
+    delimiter_table::delimiter_table(std::string_view delims)
+        : m_table{}
+    {
+        for (char c : delims)
+        {
+            m_table[static_cast<unsigned char>(c)] = true;
+        }
+    }
+
+    std::string_view
+    token_before(std::string_view input, const delimiter_table& delims, std::size_t cursor_pos)
+    {
+        std::size_t end = std::min(cursor_pos, input.size());
+        std::size_t begin = end;
+        while (begin > 0 && !delims.contains(input[begin - 1]))
+        {
+            --begin;
+        }
+        return input.substr(begin, end - begin);
+    }
+
     std::vector<std::string>
     split_line(const std::string& input, const std::string& delims, std::size_t cursor_pos)
     {
-        // passing -1 as the submatch index parameter performs splitting
+        delimiter_table table(delims);
+        std::size_t end = std::min(cursor_pos, input.size());
         std::vector<std::string> result;
-        std::stringstream ss;
-
-        ss << "[";
-        for (auto c : delims)
+        std::size_t begin = 0;
+        for (std::size_t i = 0; i < end; ++i)
         {
-            ss << "\\" << c;
+            if (table.contains(input[i]))
+            {
+                result.push_back(input.substr(begin, i - begin));
+                begin = i + 1;
+            }
         }
-        ss << "]";
+        result.push_back(input.substr(begin, end - begin));
+        return result;
+    }
 
-        std::regex re(ss.str());
+    completeness check_completeness(std::string_view code)
+    {
+        const std::size_t size = code.size();
+        if (size != 0 && code.back() == '\\')
+        {
+            return {"incomplete", line_indent(code, size - 1)};
+        }
+        // The body of cell magics is not necessarily C++.
+        const std::size_t first = code.find_first_not_of(" \t\r\n");
+        if (first != std::string_view::npos && code.compare(first, 2, "%%") == 0)
+        {
+            return {"complete", ""};
+        }
 
-        std::copy(
-            std::sregex_token_iterator(input.begin(), input.begin() + cursor_pos + 1, re, -1),
-            std::sregex_token_iterator(),
-            std::back_inserter(result)
-        );
+        // Positions of the brackets not closed yet.
+        std::vector<std::size_t> brackets;
+        std::size_t conditionals = 0;
+        // Depth of the conditionals opened in an `#if 0` block, whose lines
+        // are not code (e.g. prose with apostrophes) and are not scanned.
+        std::size_t skipped = 0;
+        bool line_start = true;
+        std::size_t i = 0;
+        while (i < size)
+        {
+            const char c = code[i];
+            if (c == '\n')
+            {
+                line_start = true;
+                ++i;
+            }
+            else if (is_blank(c))
+            {
+                ++i;
+            }
+            else if (c == '\\' && i + 1 < size && code[i + 1] == '\n')
+            {
+                i += 2;
+            }
+            else if (line_start && c == '#')
+            {
+                std::size_t j = i + 1;
+                while (j < size && is_blank(code[j]))
+                {
+                    ++j;
+                }
+                const std::size_t name = j;
+                while (j < size && is_identifier_char(code[j]))
+                {
+                    ++j;
+                }
+                const std::string_view directive = code.substr(name, j - name);
+                if (directive == "if" || directive == "ifdef" || directive == "ifndef")
+                {
+                    ++conditionals;
+                    if (skipped != 0)
+                    {
+                        ++skipped;
+                    }
+                    else if (directive == "if")
+                    {
+                        std::size_t end = j;
+                        while (end < size && code[end] != '\n' && code.compare(end, 2, "//") != 0
+                               && code.compare(end, 2, "/*") != 0)
+                        {
+                            ++end;
+                        }
+                        const std::string_view condition = code.substr(j, end - j);
+                        const std::size_t begin = condition.find_first_not_of(" \t\r");
+                        if (begin != std::string_view::npos
+                            && condition.substr(begin, condition.find_last_not_of(" \t\r") + 1 - begin) == "0")
+                        {
+                            skipped = 1;
+                        }
+                    }
+                }
+                else if (directive == "endif")
+                {
+                    if (conditionals == 0)
+                    {
+                        return {"invalid", ""};
+                    }
+                    --conditionals;
+                    if (skipped != 0)
+                    {
+                        --skipped;
+                    }
+                }
+                else if (skipped == 1
+                         && (directive == "else" || directive == "elif" || directive == "elifdef"
+                             || directive == "elifndef"))
+                {
+                    skipped = 0;
+                }
+                // The rest of the directive, continued by trailing backslashes,
+                // holds no brackets to balance.
+                while (j < size && code[j] != '\n')
+                {
+                    if (code[j] == '\\' && j + 1 < size && code[j + 1] == '\n')
+                    {
+                        j += 2;
+                    }
+                    else if (code.compare(j, 2, "//") == 0)
+                    {
+                        j = std::min(code.find('\n', j), size);
+                    }
+                    else if (code.compare(j, 2, "/*") == 0)
+                    {
+                        const std::size_t end = code.find("*/", j + 2);
+                        if (end == std::string_view::npos)
+                        {
+                            return {"incomplete", line_indent(code, i)};
+                        }
+                        j = end + 2;
+                    }
+                    else if (code[j] == '"' || code[j] == '\'')
+                    {
+                        j = std::min(skip_quoted(code, j), std::min(code.find('\n', j), size));
+                    }
+                    else
+                    {
+                        ++j;
+                    }
+                }
+                line_start = false;
+                i = j;
+            }
+            else if (skipped != 0)
+            {
+                i = std::min(code.find('\n', i), size);
+            }
+            else
+            {
+                line_start = false;
+                if (code.compare(i, 2, "//") == 0)
+                {
+                    i = std::min(code.find('\n', i), size);
+                }
+                else if (code.compare(i, 2, "/*") == 0)
+                {
+                    const std::size_t end = code.find("*/", i + 2);
+                    if (end == std::string_view::npos)
+                    {
+                        return {"incomplete", line_indent(code, i)};
+                    }
+                    i = end + 2;
+                }
+                else if (c == '"' || c == '\'')
+                {
+                    i = skip_quoted(code, i);
+                    if (i == std::string_view::npos)
+                    {
+                        return {"invalid", ""};
+                    }
+                }
+                else if (std::isdigit(static_cast<unsigned char>(c))
+                         || (c == '.' && i + 1 < size && std::isdigit(static_cast<unsigned char>(code[i + 1]))))
+                {
+                    // Numbers, whose digit separators are not character
+                    // literals.
+                    ++i;
+                    while (i < size
+                           && (is_identifier_char(code[i]) || code[i] == '.'
+                               || (code[i] == '\'' && i + 1 < size && is_identifier_char(code[i + 1]))
+                               || ((code[i] == '+' || code[i] == '-')
+                                   && std::string_view("eEpP").find(code[i - 1]) != std::string_view::npos)))
+                    {
+                        ++i;
+                    }
+                }
+                else if (is_identifier_char(c))
+                {
+                    const std::size_t begin = i;
+                    while (i < size && is_identifier_char(code[i]))
+                    {
+                        ++i;
+                    }
+                    if (i < size && code[i] == '"' && is_raw_string_prefix(code.substr(begin, i - begin)))
+                    {
+                        const std::size_t open = code.find('(', i);
+                        if (open == std::string_view::npos)
+                        {
+                            return {"invalid", ""};
+                        }
+                        std::string terminator = ")";
+                        terminator.append(code.substr(i + 1, open - i - 1));
+                        terminator += '"';
+                        const std::size_t end = code.find(terminator, open + 1);
+                        if (end == std::string_view::npos)
+                        {
+                            // Indenting would change the content of the
+                            // string.
+                            return {"incomplete", ""};
+                        }
+                        i = end + terminator.size();
+                    }
+                }
+                else if (c == '(' || c == '[' || c == '{')
+                {
+                    brackets.push_back(i);
+                    ++i;
+                }
+                else if (c == ')' || c == ']' || c == '}')
+                {
+                    const char open = c == ')' ? '(' : (c == ']' ? '[' : '{');
+                    if (brackets.empty() || code[brackets.back()] != open)
+                    {
+                        return {"invalid", ""};
+                    }
+                    brackets.pop_back();
+                    ++i;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
 
-        return result;
+        if (!brackets.empty())
+        {
+            return {"incomplete", line_indent(code, brackets.back()) + "    "};
+        }
+        if (conditionals != 0)
+        {
+            return {"incomplete", line_indent(code, size)};
+        }
+        return {"complete", ""};
     }
 }
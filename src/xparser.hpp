@@ -12,7 +12,10 @@
 
 #include "xeus-cpp/xeus_cpp_config.hpp"
 
+#include <array>
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace xcpp
@@ -20,7 +23,47 @@ namespace xcpp
     XEUS_CPP_API
     std::string trim(const std::string& str);
 
+    // Lookup table of the characters separating tokens.
+    class XEUS_CPP_API delimiter_table
+    {
+    public:
+
+        explicit delimiter_table(std::string_view delims);
+
+        bool contains(char c) const
+        {
+            return m_table[static_cast<unsigned char>(c)];
+        }
+
+    private:
+
+        std::array<bool, 256> m_table;
+    };
+
+    // Token ending at the cursor, i.e. the characters before `cursor_pos`
+    // up to the previous delimiter. It is empty after a delimiter.
+    XEUS_CPP_API std::string_view
+    token_before(std::string_view input, const delimiter_table& delims, std::size_t cursor_pos);
+
+    // Tokens of the input before `cursor_pos`, the last one being the token
+    // ending at the cursor.
     XEUS_CPP_API std::vector<std::string>
     split_line(const std::string& input, const std::string& delims, std::size_t cursor_pos);
+
+    struct completeness
+    {
+        // "complete", "incomplete" or "invalid", as in is_complete replies.
+        std::string status;
+        // Indentation of the next line of incomplete code.
+        std::string indent;
+    };
+
+    // Whether the code of a cell can be executed, or more lines are needed
+    // to close its brackets, block comments, raw strings or #if blocks, or
+    // to continue its last line after a trailing backslash. Code with a
+    // mismatched closing bracket or #endif is invalid. The lines of `#if 0`
+    // blocks are skipped. The code is only scanned, not parsed: other errors
+    // are left to the compiler.
+    XEUS_CPP_API completeness check_completeness(std::string_view code);
 }
 #endif
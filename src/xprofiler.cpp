@@ -0,0 +1,1015 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/ucontext.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <elf.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "clang/Interpreter/CppInterOp.h"
+
+#include "xprofiler.hpp"
+
+#if defined(__linux__) && !defined(sigev_notify_thread_id)
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+#if defined(__linux__) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+// Exported by the unwinder (libgcc_s or libunwind), which knows the unwind
+// tables the JIT registers.
+struct xcpp_dwarf_eh_bases
+{
+    void* tbase;
+    void* dbase;
+    void* func;
+};
+
+extern "C" const void* _Unwind_Find_FDE(void* pc, xcpp_dwarf_eh_bases* bases);
+#endif
+
+namespace xcpp
+{
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+    namespace
+    {
+        std::atomic<xprofiler*> active_profiler(nullptr);
+        pthread_t profiled_thread;
+        struct sigaction previous_action;
+
+        void profile_handler(int, siginfo_t*, void* context)
+        {
+            const int saved_errno = errno;
+            xprofiler* profiler = active_profiler.load();
+            if (profiler != nullptr && pthread_equal(pthread_self(), profiled_thread))
+            {
+                profiler->record(context);
+            }
+            errno = saved_errno;
+        }
+
+        // Program counter, frame pointer and stack pointer of an interrupted
+        // context. Returns false on architectures it does not know.
+        bool read_registers(void* context, std::uintptr_t& pc, std::uintptr_t& fp, std::uintptr_t& sp)
+        {
+            const auto* uc = static_cast<const ucontext_t*>(context);
+#if defined(__linux__) && defined(__x86_64__)
+            pc = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+            fp = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+            sp = static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RSP]);
+            return true;
+#elif defined(__linux__) && defined(__aarch64__)
+            pc = static_cast<std::uintptr_t>(uc->uc_mcontext.pc);
+            fp = static_cast<std::uintptr_t>(uc->uc_mcontext.regs[29]);
+            sp = static_cast<std::uintptr_t>(uc->uc_mcontext.sp);
+            return true;
+#elif defined(__APPLE__) && defined(__x86_64__)
+            pc = static_cast<std::uintptr_t>(uc->uc_mcontext->__ss.__rip);
+            fp = static_cast<std::uintptr_t>(uc->uc_mcontext->__ss.__rbp);
+            sp = static_cast<std::uintptr_t>(uc->uc_mcontext->__ss.__rsp);
+            return true;
+#elif defined(__APPLE__) && defined(__aarch64__)
+            pc = static_cast<std::uintptr_t>(arm_thread_state64_get_pc(uc->uc_mcontext->__ss));
+            fp = static_cast<std::uintptr_t>(arm_thread_state64_get_fp(uc->uc_mcontext->__ss));
+            sp = static_cast<std::uintptr_t>(arm_thread_state64_get_sp(uc->uc_mcontext->__ss));
+            return true;
+#else
+            (void) uc;
+            pc = fp = sp = 0;
+            return false;
+#endif
+        }
+
+        // Highest address of the stack of the calling thread, 0 if unknown.
+        std::uintptr_t stack_end()
+        {
+#if defined(__linux__)
+            pthread_attr_t attr;
+            void* address = nullptr;
+            std::size_t size = 0;
+            if (pthread_getattr_np(pthread_self(), &attr) != 0)
+            {
+                return 0;
+            }
+            const bool found = pthread_attr_getstack(&attr, &address, &size) == 0;
+            pthread_attr_destroy(&attr);
+            return found ? reinterpret_cast<std::uintptr_t>(address) + size : 0;
+#elif defined(__APPLE__)
+            return reinterpret_cast<std::uintptr_t>(pthread_get_stackaddr_np(pthread_self()));
+#else
+            return 0;
+#endif
+        }
+
+        std::string demangle(const char* symbol)
+        {
+            int status = 0;
+            std::unique_ptr<char, void (*)(void*)> res(
+                abi::__cxa_demangle(symbol, nullptr, nullptr, &status),
+                std::free
+            );
+            return status == 0 && res ? std::string(res.get()) : std::string(symbol);
+        }
+
+        std::string hex(std::uintptr_t value)
+        {
+            std::ostringstream os;
+            os << "0x" << std::hex << value;
+            return os.str();
+        }
+
+#if defined(__linux__)
+        // GDB JIT interface, see the "JIT Compilation Interface" section of
+        // the GDB manual.
+        struct jit_code_entry
+        {
+            jit_code_entry* next_entry;
+            jit_code_entry* prev_entry;
+            const char* symfile_addr;
+            std::uint64_t symfile_size;
+        };
+
+        struct jit_descriptor
+        {
+            std::uint32_t version;
+            std::uint32_t action_flag;
+            jit_code_entry* relevant_entry;
+            jit_code_entry* first_entry;
+        };
+
+        // The function symbols of an object registered by the JIT, whose
+        // section addresses are set to where they were loaded.
+        void read_elf_functions(const char* data, std::size_t size, std::vector<jit_function>& functions)
+        {
+            if (size < sizeof(Elf64_Ehdr) || std::memcmp(data, ELFMAG, SELFMAG) != 0
+                || data[EI_CLASS] != ELFCLASS64)
+            {
+                return;
+            }
+            const auto* header = reinterpret_cast<const Elf64_Ehdr*>(data);
+            if (header->e_shoff + header->e_shnum * sizeof(Elf64_Shdr) > size)
+            {
+                return;
+            }
+            const auto* sections = reinterpret_cast<const Elf64_Shdr*>(data + header->e_shoff);
+            for (std::size_t i = 0; i < header->e_shnum; ++i)
+            {
+                const Elf64_Shdr& symtab = sections[i];
+                if (symtab.sh_type != SHT_SYMTAB || symtab.sh_link >= header->e_shnum
+                    || symtab.sh_offset + symtab.sh_size > size)
+                {
+                    continue;
+                }
+                const Elf64_Shdr& strtab = sections[symtab.sh_link];
+                const auto* symbols = reinterpret_cast<const Elf64_Sym*>(data + symtab.sh_offset);
+                const std::size_t count = symtab.sh_size / sizeof(Elf64_Sym);
+                for (std::size_t j = 0; j < count; ++j)
+                {
+                    const Elf64_Sym& symbol = symbols[j];
+                    if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC || symbol.st_size == 0
+                        || symbol.st_shndx == SHN_UNDEF || symbol.st_shndx >= header->e_shnum
+                        || symbol.st_name >= strtab.sh_size)
+                    {
+                        continue;
+                    }
+                    std::uintptr_t address = symbol.st_value;
+                    if (header->e_type == ET_REL)
+                    {
+                        address += sections[symbol.st_shndx].sh_addr;
+                    }
+                    const char* name = data + strtab.sh_offset + symbol.st_name;
+                    functions.push_back({address, static_cast<std::size_t>(symbol.st_size), demangle(name), true});
+                }
+            }
+        }
+
+        // Reads a value of the DWARF exception handling pointer encoding
+        // `encoding`, ignoring how it is applied (e.g. pc relative), and
+        // advances `p` past it.
+        bool read_encoded(const unsigned char*& p, unsigned char encoding, std::uint64_t& value)
+        {
+            switch (encoding & 0x0f)
+            {
+                case 0x00:  // DW_EH_PE_absptr
+                case 0x04:  // DW_EH_PE_udata8
+                case 0x0c:  // DW_EH_PE_sdata8
+                    std::memcpy(&value, p, 8);
+                    p += 8;
+                    return true;
+                case 0x03:  // DW_EH_PE_udata4
+                case 0x0b:  // DW_EH_PE_sdata4
+                {
+                    std::uint32_t v;
+                    std::memcpy(&v, p, 4);
+                    value = v;
+                    p += 4;
+                    return true;
+                }
+                case 0x02:  // DW_EH_PE_udata2
+                case 0x0a:  // DW_EH_PE_sdata2
+                {
+                    std::uint16_t v;
+                    std::memcpy(&v, p, 2);
+                    value = v;
+                    p += 2;
+                    return true;
+                }
+                case 0x01:  // DW_EH_PE_uleb128
+                case 0x09:  // DW_EH_PE_sleb128
+                {
+                    value = 0;
+                    unsigned shift = 0;
+                    while (*p & 0x80)
+                    {
+                        value |= static_cast<std::uint64_t>(*p++ & 0x7f) << shift;
+                        shift += 7;
+                    }
+                    value |= static_cast<std::uint64_t>(*p++) << shift;
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        // Pointer encoding of the FDEs of a CIE, given by the 'R' entry of
+        // its augmentation.
+        bool read_fde_encoding(const unsigned char* cie, unsigned char& encoding)
+        {
+            std::uint64_t skipped;
+            // Skips the length and the CIE id.
+            const unsigned char* p = cie + 8;
+            const unsigned char version = *p++;
+            const char* augmentation = reinterpret_cast<const char*>(p);
+            p += std::strlen(augmentation) + 1;
+            encoding = 0x00;
+            if (augmentation[0] != 'z')
+            {
+                return augmentation[0] == '\0';
+            }
+            if (version >= 4)
+            {
+                // Address and segment selector sizes.
+                p += 2;
+            }
+            // Code and data alignment factors, return address register and
+            // augmentation length.
+            read_encoded(p, 0x01, skipped);
+            read_encoded(p, 0x09, skipped);
+            if (version == 1)
+            {
+                ++p;
+            }
+            else
+            {
+                read_encoded(p, 0x01, skipped);
+            }
+            read_encoded(p, 0x01, skipped);
+            for (const char* a = augmentation + 1; *a != '\0'; ++a)
+            {
+                if (*a == 'R')
+                {
+                    encoding = *p;
+                    return encoding != 0xff;
+                }
+                else if (*a == 'P')
+                {
+                    const unsigned char personality = *p++;
+                    // DW_EH_PE_aligned is not supported.
+                    if ((personality & 0x70) == 0x50 || !read_encoded(p, personality, skipped))
+                    {
+                        return false;
+                    }
+                }
+                else if (*a == 'L')
+                {
+                    ++p;
+                }
+                else if (*a != 'S' && *a != 'B')
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Size of the function starting at `address`, read from the range
+        // of its FDE in the unwind tables known to the unwinder. Returns 0
+        // when there is no such FDE.
+        std::size_t fde_function_size(std::uintptr_t address)
+        {
+#if !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+            xcpp_dwarf_eh_bases bases;
+            const auto* fde = static_cast<const unsigned char*>(
+                _Unwind_Find_FDE(reinterpret_cast<void*>(address), &bases)
+            );
+            if (fde == nullptr || reinterpret_cast<std::uintptr_t>(bases.func) != address)
+            {
+                return 0;
+            }
+            std::uint32_t length;
+            std::memcpy(&length, fde, 4);
+            // 64-bit DWARF is not used in .eh_frame.
+            if (length == 0xffffffff)
+            {
+                return 0;
+            }
+            std::uint32_t cie_offset;
+            std::memcpy(&cie_offset, fde + 4, 4);
+            unsigned char encoding;
+            if (!read_fde_encoding(fde + 4 - cie_offset, encoding))
+            {
+                return 0;
+            }
+            const unsigned char* p = fde + 8;
+            std::uint64_t begin;
+            std::uint64_t range;
+            if (!read_encoded(p, encoding, begin) || !read_encoded(p, encoding, range))
+            {
+                return 0;
+            }
+            return static_cast<std::size_t>(range);
+#else
+            (void) address;
+            return 0;
+#endif
+        }
+#endif
+
+        void read_debugger_functions(std::vector<jit_function>& functions)
+        {
+#if defined(__linux__)
+            const auto* descriptor = static_cast<const jit_descriptor*>(dlsym(RTLD_DEFAULT, "__jit_debug_descriptor"));
+            if (descriptor == nullptr)
+            {
+                return;
+            }
+            for (const jit_code_entry* entry = descriptor->first_entry; entry != nullptr; entry = entry->next_entry)
+            {
+                read_elf_functions(entry->symfile_addr, static_cast<std::size_t>(entry->symfile_size), functions);
+            }
+#else
+            (void) functions;
+#endif
+        }
+
+        // Functions of the global scope. Their sizes are read from their
+        // unwind information, or else estimated from the distance to the
+        // next one.
+        void read_interpreter_functions(std::vector<jit_function>& functions)
+        {
+            std::set<std::string> names;
+            Cpp::GetAllCppNames(Cpp::GetGlobalScope(), names);
+            for (const std::string& name : names)
+            {
+                // Skips the reserved names of the standard library.
+                if (name.empty() || name[0] == '_')
+                {
+                    continue;
+                }
+                for (Cpp::TCppFunction_t function : Cpp::GetFunctionsUsingName(Cpp::GetGlobalScope(), name))
+                {
+                    void* address = Cpp::GetFunctionAddress(function);
+                    Dl_info info;
+                    if (address != nullptr && dladdr(address, &info) == 0)
+                    {
+                        functions.push_back(
+                            {reinterpret_cast<std::uintptr_t>(address), 0, Cpp::GetFunctionSignature(function), false}
+                        );
+                    }
+                }
+            }
+            std::sort(
+                functions.begin(),
+                functions.end(),
+                [](const jit_function& lhs, const jit_function& rhs)
+                {
+                    return lhs.address < rhs.address;
+                }
+            );
+            for (std::size_t i = 0; i < functions.size(); ++i)
+            {
+#if defined(__linux__)
+                functions[i].size = fde_function_size(functions[i].address);
+                functions[i].exact = functions[i].size > 0;
+#endif
+                if (!functions[i].exact && i + 1 < functions.size())
+                {
+                    const std::size_t gap = functions[i + 1].address - functions[i].address;
+                    functions[i].size = gap < 64 * 1024 ? gap : 0;
+                }
+            }
+        }
+
+        std::uint64_t monotonic_ns()
+        {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(ts.tv_nsec);
+        }
+
+        template <class T>
+        void append(std::string& buffer, const T& value)
+        {
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+    }
+
+    xprofiler::xprofiler(std::size_t interval_us, std::size_t max_samples)
+        : m_interval_us(std::max<std::size_t>(interval_us, 1))
+        , m_max_samples(max_samples)
+        , m_frames(max_samples * max_depth)
+        , m_depths(max_samples, 0)
+        , m_count(0)
+        , m_dropped(0)
+        , m_stack_end(0)
+        , m_running(false)
+        , p_timer(nullptr)
+    {
+    }
+
+    xprofiler::~xprofiler()
+    {
+        stop();
+    }
+
+    bool xprofiler::start()
+    {
+        xprofiler* expected = nullptr;
+        if (m_running || !active_profiler.compare_exchange_strong(expected, this))
+        {
+            return false;
+        }
+        m_stack_end = stack_end();
+        profiled_thread = pthread_self();
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = profile_handler;
+        action.sa_flags = SA_RESTART | SA_SIGINFO;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, &previous_action);
+
+        const time_t seconds = static_cast<time_t>(m_interval_us / 1000000);
+        const long micros = static_cast<long>(m_interval_us % 1000000);
+#if defined(__linux__)
+        // A timer on the CPU clock of the thread only samples the cell, not
+        // the other threads of the kernel.
+        clockid_t clock;
+        auto* timer = new timer_t;
+        sigevent event;
+        std::memset(&event, 0, sizeof(event));
+        event.sigev_notify = SIGEV_THREAD_ID;
+        event.sigev_signo = SIGPROF;
+        event.sigev_notify_thread_id = static_cast<pid_t>(syscall(SYS_gettid));
+        itimerspec spec;
+        spec.it_interval.tv_sec = seconds;
+        spec.it_interval.tv_nsec = micros * 1000;
+        spec.it_value = spec.it_interval;
+        if (pthread_getcpuclockid(pthread_self(), &clock) != 0 || timer_create(clock, &event, timer) != 0)
+        {
+            delete timer;
+            sigaction(SIGPROF, &previous_action, nullptr);
+            active_profiler.store(nullptr);
+            return false;
+        }
+        timer_settime(*timer, 0, &spec, nullptr);
+        p_timer = timer;
+#else
+        itimerval spec;
+        spec.it_interval.tv_sec = seconds;
+        spec.it_interval.tv_usec = static_cast<suseconds_t>(micros);
+        spec.it_value = spec.it_interval;
+        setitimer(ITIMER_PROF, &spec, nullptr);
+#endif
+        m_running = true;
+        return true;
+    }
+
+    void xprofiler::stop()
+    {
+        if (!m_running)
+        {
+            return;
+        }
+#if defined(__linux__)
+        auto* timer = static_cast<timer_t*>(p_timer);
+        timer_delete(*timer);
+        delete timer;
+        p_timer = nullptr;
+#else
+        itimerval spec;
+        std::memset(&spec, 0, sizeof(spec));
+        setitimer(ITIMER_PROF, &spec, nullptr);
+#endif
+        active_profiler.store(nullptr);
+        sigaction(SIGPROF, &previous_action, nullptr);
+        m_running = false;
+    }
+
+    void xprofiler::record(void* context)
+    {
+        const std::size_t index = m_count.fetch_add(1);
+        if (index >= m_max_samples)
+        {
+            m_dropped.fetch_add(1);
+            return;
+        }
+        // The stack is walked through the frame pointers rather than with
+        // backtrace(): the unwinder looks up the unwind tables the JIT
+        // registers under a lock (libgcc before GCC 13), which a sample
+        // taken while the cell unwinds an exception would deadlock on.
+        // Only the stack between the interrupted frame and the end of the
+        // stack of the thread is read.
+        void** frames = &m_frames[index * max_depth];
+        std::uintptr_t pc;
+        std::uintptr_t fp;
+        std::uintptr_t sp;
+        int depth = 0;
+        if (read_registers(context, pc, fp, sp))
+        {
+            frames[depth++] = reinterpret_cast<void*>(pc);
+            while (static_cast<std::size_t>(depth) < max_depth && fp >= sp && fp % sizeof(void*) == 0
+                   && fp + 2 * sizeof(void*) <= m_stack_end)
+            {
+                const auto* frame = reinterpret_cast<const std::uintptr_t*>(fp);
+                if (frame[1] == 0)
+                {
+                    break;
+                }
+                frames[depth++] = reinterpret_cast<void*>(frame[1]);
+                // The frames of the callers are higher on the stack.
+                if (frame[0] <= fp)
+                {
+                    break;
+                }
+                fp = frame[0];
+            }
+        }
+        m_depths[index] = depth;
+    }
+
+    std::vector<std::vector<void*>> xprofiler::samples() const
+    {
+        std::vector<std::vector<void*>> res;
+        const std::size_t count = std::min(m_count.load(), m_max_samples);
+        res.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            void* const* frames = &m_frames[i * max_depth];
+            const std::size_t depth = static_cast<std::size_t>(std::max(m_depths[i], 0));
+            if (depth != 0)
+            {
+                res.emplace_back(frames, frames + depth);
+            }
+        }
+        return res;
+    }
+
+    std::size_t xprofiler::dropped() const
+    {
+        return m_dropped.load();
+    }
+
+    xsymbolizer::xsymbolizer()
+    {
+        read_debugger_functions(m_functions);
+        if (m_functions.empty())
+        {
+            read_interpreter_functions(m_functions);
+        }
+        std::sort(
+            m_functions.begin(),
+            m_functions.end(),
+            [](const jit_function& lhs, const jit_function& rhs)
+            {
+                return lhs.address < rhs.address;
+            }
+        );
+    }
+
+    std::string xsymbolizer::name(void* address)
+    {
+        const auto key = reinterpret_cast<std::uintptr_t>(address);
+        auto cached = m_cache.find(key);
+        if (cached != m_cache.end())
+        {
+            return cached->second;
+        }
+
+        std::string res;
+        Dl_info info;
+        if (dladdr(address, &info) != 0)
+        {
+            if (info.dli_sname != nullptr)
+            {
+                res = demangle(info.dli_sname);
+            }
+            else
+            {
+                std::string file = info.dli_fname != nullptr ? info.dli_fname : "?";
+                res = file.substr(file.find_last_of('/') + 1) + "+"
+                      + hex(key - reinterpret_cast<std::uintptr_t>(info.dli_fbase));
+            }
+        }
+        else
+        {
+            auto it = std::upper_bound(
+                m_functions.begin(),
+                m_functions.end(),
+                key,
+                [](std::uintptr_t value, const jit_function& f)
+                {
+                    return value < f.address;
+                }
+            );
+            if (it != m_functions.begin() && key < std::prev(it)->address + std::prev(it)->size)
+            {
+                res = std::prev(it)->name;
+            }
+            else
+            {
+                std::uintptr_t start = key;
+#if defined(__linux__)
+                xcpp_dwarf_eh_bases bases;
+                if (_Unwind_Find_FDE(address, &bases) != nullptr)
+                {
+                    start = reinterpret_cast<std::uintptr_t>(bases.func);
+                }
+#endif
+                auto exact = std::find_if(
+                    m_functions.begin(),
+                    m_functions.end(),
+                    [start](const jit_function& f)
+                    {
+                        return f.address == start;
+                    }
+                );
+                res = exact != m_functions.end() ? exact->name : "[jit] " + hex(start);
+            }
+        }
+        m_cache.emplace(key, res);
+        return res;
+    }
+
+    bool xsymbolizer::is_jit(void* address) const
+    {
+        Dl_info info;
+        return dladdr(address, &info) == 0;
+    }
+
+    const std::vector<jit_function>& xsymbolizer::jit_functions() const
+    {
+        return m_functions;
+    }
+
+    std::string write_perf_map(const std::vector<jit_function>& functions)
+    {
+        std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (file == nullptr)
+        {
+            return "";
+        }
+        for (const jit_function& f : functions)
+        {
+            if (f.exact)
+            {
+                std::fprintf(
+                    file,
+                    "%llx %llx %s\n",
+                    static_cast<unsigned long long>(f.address),
+                    static_cast<unsigned long long>(f.size),
+                    f.name.c_str()
+                );
+            }
+        }
+        std::fclose(file);
+        return path;
+    }
+
+    std::string write_jitdump(const std::vector<jit_function>& functions, const std::string& dir)
+    {
+#if defined(__linux__)
+        static std::set<std::uintptr_t> dumped;
+        static bool mapped = false;
+
+        const std::string path = dir + "/jit-" + std::to_string(getpid()) + ".dump";
+        const bool exists = access(path.c_str(), F_OK) == 0;
+        int fd = ::open(path.c_str(), O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            return "";
+        }
+        if (!exists)
+        {
+            dumped.clear();
+            mapped = false;
+        }
+
+        std::string buffer;
+        if (!exists)
+        {
+            append<std::uint32_t>(buffer, 0x4A695444);  // "JiTD"
+            append<std::uint32_t>(buffer, 1);           // version
+            append<std::uint32_t>(buffer, 40);          // header size
+#if defined(__x86_64__)
+            append<std::uint32_t>(buffer, EM_X86_64);
+#elif defined(__aarch64__)
+            append<std::uint32_t>(buffer, EM_AARCH64);
+#else
+            append<std::uint32_t>(buffer, EM_NONE);
+#endif
+            append<std::uint32_t>(buffer, 0);
+            append<std::uint32_t>(buffer, static_cast<std::uint32_t>(getpid()));
+            append<std::uint64_t>(buffer, monotonic_ns());
+            append<std::uint64_t>(buffer, 0);
+        }
+        const auto tid = static_cast<std::uint32_t>(syscall(SYS_gettid));
+        for (const jit_function& f : functions)
+        {
+            // The code is copied, which an estimated size could read past.
+            if (!f.exact || f.size == 0 || !dumped.insert(f.address).second)
+            {
+                continue;
+            }
+            // JIT_CODE_LOAD record.
+            append<std::uint32_t>(buffer, 0);
+            append<std::uint32_t>(buffer, static_cast<std::uint32_t>(16 + 8 + 32 + f.name.size() + 1 + f.size));
+            append<std::uint64_t>(buffer, monotonic_ns());
+            append<std::uint32_t>(buffer, static_cast<std::uint32_t>(getpid()));
+            append<std::uint32_t>(buffer, tid);
+            append<std::uint64_t>(buffer, f.address);
+            append<std::uint64_t>(buffer, f.address);
+            append<std::uint64_t>(buffer, f.size);
+            append<std::uint64_t>(buffer, dumped.size());
+            buffer.append(f.name.c_str(), f.name.size() + 1);
+            buffer.append(reinterpret_cast<const char*>(f.address), f.size);
+        }
+        bool ok = ::write(fd, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size());
+
+        // perf record spots the dump through an executable mapping of it.
+        if (ok && !mapped)
+        {
+            mapped = ::mmap(nullptr, static_cast<std::size_t>(sysconf(_SC_PAGESIZE)), PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, 0)
+                     != MAP_FAILED;
+        }
+        ::close(fd);
+        return ok ? path : "";
+#else
+        (void) functions;
+        (void) dir;
+        return "";
+#endif
+    }
+#else
+    xprofiler::xprofiler(std::size_t interval_us, std::size_t max_samples)
+        : m_interval_us(interval_us)
+        , m_max_samples(max_samples)
+        , m_count(0)
+        , m_dropped(0)
+        , m_stack_end(0)
+        , m_running(false)
+        , p_timer(nullptr)
+    {
+    }
+
+    xprofiler::~xprofiler()
+    {
+    }
+
+    bool xprofiler::start()
+    {
+        return false;
+    }
+
+    void xprofiler::stop()
+    {
+    }
+
+    void xprofiler::record(void*)
+    {
+    }
+
+    std::vector<std::vector<void*>> xprofiler::samples() const
+    {
+        return {};
+    }
+
+    std::size_t xprofiler::dropped() const
+    {
+        return 0;
+    }
+
+    xsymbolizer::xsymbolizer()
+    {
+    }
+
+    std::string xsymbolizer::name(void* address)
+    {
+        std::ostringstream os;
+        os << address;
+        return os.str();
+    }
+
+    bool xsymbolizer::is_jit(void*) const
+    {
+        return false;
+    }
+
+    const std::vector<jit_function>& xsymbolizer::jit_functions() const
+    {
+        return m_functions;
+    }
+
+    std::string write_perf_map(const std::vector<jit_function>&)
+    {
+        return "";
+    }
+
+    std::string write_jitdump(const std::vector<jit_function>&, const std::string&)
+    {
+        return "";
+    }
+#endif
+
+    namespace
+    {
+        struct flame_node
+        {
+            std::string name;
+            std::size_t count = 0;
+            std::map<std::string, flame_node> children;
+        };
+
+        std::string xml_escape(const std::string& s)
+        {
+            std::string res;
+            res.reserve(s.size());
+            for (char c : s)
+            {
+                switch (c)
+                {
+                    case '&':
+                        res += "&amp;";
+                        break;
+                    case '<':
+                        res += "&lt;";
+                        break;
+                    case '>':
+                        res += "&gt;";
+                        break;
+                    case '"':
+                        res += "&quot;";
+                        break;
+                    default:
+                        res += c;
+                }
+            }
+            return res;
+        }
+
+        std::size_t tree_depth(const flame_node& node)
+        {
+            std::size_t depth = 0;
+            for (const auto& child : node.children)
+            {
+                depth = std::max(depth, tree_depth(child.second));
+            }
+            return depth + 1;
+        }
+
+        constexpr double graph_width = 1200;
+        constexpr double frame_height = 16;
+        constexpr double char_width = 7;
+
+        std::string frame_color(const std::string& name)
+        {
+            const std::size_t h = std::hash<std::string>()(name);
+            std::ostringstream os;
+            os << "rgb(" << 205 + h % 50 << "," << 80 + (h / 50) % 130 << "," << 50 + (h / 6500) % 50 << ")";
+            return os.str();
+        }
+
+        std::string fitting_label(const std::string& name, double width)
+        {
+            const std::size_t chars = static_cast<std::size_t>(width / char_width);
+            if (chars < 3)
+            {
+                return "";
+            }
+            return name.size() <= chars ? name : name.substr(0, chars - 2) + "..";
+        }
+
+        void render_node(
+            const flame_node& node,
+            std::size_t total,
+            double x,
+            std::size_t level,
+            double height,
+            std::ostringstream& os
+        )
+        {
+            const double fraction = static_cast<double>(node.count) / static_cast<double>(total);
+            const double width = fraction * graph_width;
+            if (width < 0.1)
+            {
+                return;
+            }
+            const double y = height - (static_cast<double>(level) + 1) * frame_height;
+            os << "<g class=\"f\" onclick=\"xcppFlameZoom(this)\"><title>" << xml_escape(node.name) << " ("
+               << node.count << " samples, " << std::fixed << std::setprecision(2) << fraction * 100 << "%)</title>"
+               << "<rect x=\"" << x << "\" y=\"" << y << "\" width=\"" << width << "\" height=\""
+               << frame_height - 1 << "\" data-x=\"" << x / graph_width << "\" data-w=\"" << fraction
+               << "\" fill=\"" << frame_color(node.name) << "\" rx=\"2\"/>"
+               << "<text x=\"" << x + 3 << "\" y=\"" << y + frame_height - 4 << "\" data-name=\""
+               << xml_escape(node.name) << "\">" << xml_escape(fitting_label(node.name, width)) << "</text></g>\n";
+            for (const auto& child : node.children)
+            {
+                render_node(child.second, total, x, level + 1, height, os);
+                x += static_cast<double>(child.second.count) / static_cast<double>(total) * graph_width;
+            }
+        }
+
+        // Click to zoom on a frame, click on the root to reset.
+        const char* zoom_script = R"(<script><![CDATA[
+function xcppFlameZoom(g) {
+  var svg = g.ownerSVGElement, W = 1200, r = g.querySelector('rect');
+  var x0 = +r.getAttribute('data-x'), w0 = +r.getAttribute('data-w'), y0 = +r.getAttribute('y');
+  svg.querySelectorAll('g.f').forEach(function (n) {
+    var q = n.querySelector('rect'), t = n.querySelector('text');
+    var x = +q.getAttribute('data-x'), w = +q.getAttribute('data-w'), y = +q.getAttribute('y');
+    var visible = y >= y0 ? (x <= x0 + 1e-9 && x + w >= x0 + w0 - 1e-9) : (x >= x0 - 1e-9 && x + w <= x0 + w0 + 1e-9);
+    n.style.display = visible ? '' : 'none';
+    if (!visible) return;
+    var nx = y >= y0 ? 0 : (x - x0) / w0 * W, nw = y >= y0 ? W : w / w0 * W;
+    q.setAttribute('x', nx); q.setAttribute('width', nw); t.setAttribute('x', nx + 3);
+    var name = t.getAttribute('data-name'), c = Math.floor(nw / 7);
+    t.textContent = c < 3 ? '' : (name.length <= c ? name : name.substring(0, c - 2) + '..');
+  });
+}
+]]></script>
+)";
+    }
+
+    std::string render_flame_graph(const folded_stacks& stacks, const std::string& title)
+    {
+        flame_node root;
+        root.name = "all";
+        for (const auto& stack : stacks)
+        {
+            root.count += stack.second;
+            flame_node* node = &root;
+            for (const std::string& frame : stack.first)
+            {
+                flame_node& child = node->children[frame];
+                child.name = frame;
+                child.count += stack.second;
+                node = &child;
+            }
+        }
+
+        const double title_height = 24;
+        const double height = static_cast<double>(tree_depth(root)) * frame_height + title_height;
+        std::ostringstream os;
+        os << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << graph_width << "\" height=\"" << height
+           << "\" viewBox=\"0 0 " << graph_width << " " << height
+           << "\" style=\"font-family:monospace;font-size:11px\">\n"
+           << zoom_script << "<text x=\"" << graph_width / 2 << "\" y=\"16\" text-anchor=\"middle\" font-size=\"14\">"
+           << xml_escape(title) << "</text>\n";
+        if (root.count > 0)
+        {
+            render_node(root, root.count, 0, 0, height, os);
+        }
+        os << "</svg>\n";
+        return os.str();
+    }
+}
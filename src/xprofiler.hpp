@@ -0,0 +1,132 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_PROFILER_HPP
+#define XEUS_CPP_PROFILER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "xeus-cpp/xeus_cpp_config.hpp"
+
+namespace xcpp
+{
+    /**
+     * Sampling profiler of the calling thread.
+     *
+     * While started, the thread receives SIGPROF every `interval_us`
+     * microseconds of CPU time it consumes, and the handler records its call
+     * stack by following the frame pointers, which the kernel keeps in JIT
+     * compiled code (-fno-omit-frame-pointer). Frames of functions compiled
+     * without them, typically leaf functions of system libraries, hide
+     * their caller.
+     *
+     * Only one profiler can run at a time. Only available on POSIX systems.
+     */
+    class XEUS_CPP_API xprofiler
+    {
+    public:
+
+        static constexpr std::size_t max_depth = 64;
+
+        explicit xprofiler(std::size_t interval_us = 1000, std::size_t max_samples = 20000);
+        ~xprofiler();
+
+        xprofiler(const xprofiler&) = delete;
+        xprofiler& operator=(const xprofiler&) = delete;
+
+        bool start();
+        void stop();
+
+        // Return addresses of each sample, innermost first, starting at the
+        // interrupted function.
+        std::vector<std::vector<void*>> samples() const;
+
+        // Samples lost because the buffer was full.
+        std::size_t dropped() const;
+
+        // Called by the signal handler with the interrupted context.
+        void record(void* context);
+
+    private:
+
+        std::size_t m_interval_us;
+        std::size_t m_max_samples;
+        std::vector<void*> m_frames;
+        std::vector<int> m_depths;
+        std::atomic<std::size_t> m_count;
+        std::atomic<std::size_t> m_dropped;
+        std::uintptr_t m_stack_end;
+        bool m_running;
+        void* p_timer;
+    };
+
+    // Function generated by the JIT.
+    struct jit_function
+    {
+        std::uintptr_t address;
+        std::size_t size;
+        std::string name;
+        // Whether the size comes from a symbol table or unwind information,
+        // rather than being estimated from the next function.
+        bool exact;
+    };
+
+    /**
+     * Names of the addresses of a process running JIT compiled code.
+     *
+     * Functions of the loaded libraries are found with dladdr. JIT compiled
+     * functions are read from the symbol tables the JIT hands to debuggers
+     * through the GDB JIT interface. When it is not available, the functions
+     * of the global scope are looked up through CppInterOp, and the start of
+     * the JIT compiled function containing an address is found with its
+     * unwind information.
+     */
+    class XEUS_CPP_API xsymbolizer
+    {
+    public:
+
+        xsymbolizer();
+
+        // Name of the function containing `address`, demangled.
+        std::string name(void* address);
+
+        // Whether `address` is in code generated by the JIT.
+        bool is_jit(void* address) const;
+
+        const std::vector<jit_function>& jit_functions() const;
+
+    private:
+
+        std::vector<jit_function> m_functions;
+        std::map<std::uintptr_t, std::string> m_cache;
+    };
+
+    // Writes the JIT compiled functions whose size is exact to
+    // /tmp/perf-<pid>.map, which perf report reads to name the samples in
+    // JIT compiled code. Returns the path, or an empty string on failure.
+    XEUS_CPP_API std::string write_perf_map(const std::vector<jit_function>& functions);
+
+    // Writes the JIT compiled functions whose size is exact, with their
+    // code, to a jitdump file (<dir>/jit-<pid>.dump) and maps it, which is
+    // what `perf record -k 1` looks for; `perf inject --jit` then makes them
+    // available to perf report. Returns the path, or an empty string on failure.
+    XEUS_CPP_API std::string write_jitdump(const std::vector<jit_function>& functions, const std::string& dir);
+
+    // Call stacks, outermost frame first, and their number of samples.
+    using folded_stacks = std::map<std::vector<std::string>, std::size_t>;
+
+    // Flame graph of `stacks` as a standalone SVG document.
+    XEUS_CPP_API std::string render_flame_graph(const folded_stacks& stacks, const std::string& title);
+}
+
+#endif
@@ -0,0 +1,570 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define XEUS_CPP_TAGINDEX_MMAP
+#endif
+
+#include <pugixml.hpp>
+
+#include "xtagindex.hpp"
+
+namespace fs = std::filesystem;
+
+namespace xcpp
+{
+    namespace
+    {
+        constexpr char index_magic[8] = {'X', 'C', 'P', 'P', 'T', 'A', 'G', '\0'};
+        constexpr std::uint32_t index_version = 1;
+
+        enum table_id : std::size_t
+        {
+            entity_table = 0,
+            member_table = 1,
+            table_count = 2
+        };
+
+        struct index_table
+        {
+            std::uint64_t bucket_offset;
+            std::uint64_t entry_offset;
+            std::uint32_t bucket_count;
+            std::uint32_t entry_count;
+        };
+
+        struct index_header
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t reserved;
+            std::uint64_t source_mtime;
+            std::uint64_t source_size;
+            index_table tables[table_count];
+            std::uint64_t strings_offset;
+            std::uint64_t strings_size;
+        };
+
+        struct index_entry
+        {
+            std::uint64_t hash;
+            std::uint32_t first_offset;
+            std::uint32_t first_size;
+            std::uint32_t second_offset;
+            std::uint32_t second_size;
+            std::uint32_t value_offset;
+            std::uint32_t value_size;
+        };
+
+        // FNV-1a over both parts of the key, separated by a unit separator
+        // so that ("ab", "c") and ("a", "bc") do not collide trivially.
+        std::uint64_t hash_key(const char* first, std::size_t first_size, const char* second, std::size_t second_size)
+        {
+            std::uint64_t h = 14695981039346656037ULL;
+            auto mix = [&h](const char* s, std::size_t n)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    h ^= static_cast<unsigned char>(s[i]);
+                    h *= 1099511628211ULL;
+                }
+            };
+            mix(first, first_size);
+            mix("\x1f", 1);
+            mix(second, second_size);
+            return h;
+        }
+
+        std::uint64_t hash_key(const std::string& first, const std::string& second)
+        {
+            return hash_key(first.data(), first.size(), second.data(), second.size());
+        }
+
+        std::size_t align8(std::size_t n)
+        {
+            return (n + 7) & ~std::size_t(7);
+        }
+
+        bool source_stamp(const std::string& tagfile, std::uint64_t& mtime, std::uint64_t& size)
+        {
+            std::error_code ec;
+            auto time = fs::last_write_time(tagfile, ec);
+            if (ec)
+            {
+                return false;
+            }
+            auto file_size = fs::file_size(tagfile, ec);
+            if (ec)
+            {
+                return false;
+            }
+            mtime = static_cast<std::uint64_t>(time.time_since_epoch().count());
+            size = static_cast<std::uint64_t>(file_size);
+            return true;
+        }
+
+        class string_pool
+        {
+        public:
+
+            std::uint32_t add(const std::string& s)
+            {
+                auto it = m_offsets.find(s);
+                if (it != m_offsets.end())
+                {
+                    return it->second;
+                }
+                auto offset = static_cast<std::uint32_t>(m_data.size());
+                m_data += s;
+                m_offsets.emplace(s, offset);
+                return offset;
+            }
+
+            const std::string& data() const
+            {
+                return m_data;
+            }
+
+        private:
+
+            std::string m_data;
+            std::unordered_map<std::string, std::uint32_t> m_offsets;
+        };
+
+        class table_builder
+        {
+        public:
+
+            void insert(string_pool& pool, const std::string& first, const std::string& second, const std::string& value)
+            {
+                // First occurrence in document order wins.
+                if (!m_keys.emplace(first + '\x1f' + second).second)
+                {
+                    return;
+                }
+                index_entry entry;
+                entry.hash = hash_key(first, second);
+                entry.first_offset = pool.add(first);
+                entry.first_size = static_cast<std::uint32_t>(first.size());
+                entry.second_offset = pool.add(second);
+                entry.second_size = static_cast<std::uint32_t>(second.size());
+                entry.value_offset = pool.add(value);
+                entry.value_size = static_cast<std::uint32_t>(value.size());
+                m_entries.push_back(entry);
+            }
+
+            std::uint32_t bucket_count() const
+            {
+                // Keep the load factor under 1/2 so that probing stays short
+                // and always reaches an empty bucket.
+                std::uint32_t count = 2;
+                while (count < 2 * m_entries.size())
+                {
+                    count *= 2;
+                }
+                return count;
+            }
+
+            std::vector<std::uint32_t> buckets() const
+            {
+                std::vector<std::uint32_t> result(bucket_count(), 0);
+                const std::size_t mask = result.size() - 1;
+                for (std::size_t i = 0; i < m_entries.size(); ++i)
+                {
+                    std::size_t slot = m_entries[i].hash & mask;
+                    while (result[slot] != 0)
+                    {
+                        slot = (slot + 1) & mask;
+                    }
+                    result[slot] = static_cast<std::uint32_t>(i + 1);
+                }
+                return result;
+            }
+
+            const std::vector<index_entry>& entries() const
+            {
+                return m_entries;
+            }
+
+        private:
+
+            std::vector<index_entry> m_entries;
+            std::unordered_set<std::string> m_keys;
+        };
+
+        bool is_class(const std::string& kind)
+        {
+            return kind == "class" || kind == "struct";
+        }
+
+        // Depth-first traversal in document order, as pugi::xml_node::find_node.
+        void index_children(pugi::xml_node node, string_pool& pool, table_builder* tables)
+        {
+            for (pugi::xml_node child : node.children())
+            {
+                std::string kind = child.attribute("kind").value();
+                if (!kind.empty())
+                {
+                    std::string name = child.child("name").child_value();
+                    if (is_class(kind))
+                    {
+                        tables[entity_table].insert(pool, kind, name, child.child("filename").child_value());
+                        for (pugi::xml_node member : child.children())
+                        {
+                            if (static_cast<std::string>(member.attribute("kind").value()) == "function")
+                            {
+                                tables[member_table].insert(
+                                    pool,
+                                    name,
+                                    member.child("name").child_value(),
+                                    member.child("anchorfile").child_value()
+                                );
+                            }
+                        }
+                    }
+                    else
+                    {
+                        tables[entity_table].insert(pool, kind, name, child.child("anchorfile").child_value());
+                    }
+                }
+                index_children(child, pool, tables);
+            }
+        }
+
+        template <class T>
+        void write_at(std::vector<char>& buffer, std::size_t offset, const T* data, std::size_t count)
+        {
+            std::memcpy(buffer.data() + offset, data, count * sizeof(T));
+        }
+    }
+
+    /*****************************
+     * xtag_index implementation *
+     *****************************/
+
+    xtag_index::~xtag_index()
+    {
+        close();
+    }
+
+    xtag_index::xtag_index(xtag_index&& rhs) noexcept
+        : p_data(rhs.p_data)
+        , m_size(rhs.m_size)
+        , m_mapped(rhs.m_mapped)
+        , m_buffer(std::move(rhs.m_buffer))
+    {
+        rhs.p_data = nullptr;
+        rhs.m_size = 0;
+        rhs.m_mapped = false;
+    }
+
+    xtag_index& xtag_index::operator=(xtag_index&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            close();
+            p_data = rhs.p_data;
+            m_size = rhs.m_size;
+            m_mapped = rhs.m_mapped;
+            m_buffer = std::move(rhs.m_buffer);
+            rhs.p_data = nullptr;
+            rhs.m_size = 0;
+            rhs.m_mapped = false;
+        }
+        return *this;
+    }
+
+    bool xtag_index::load(const std::string& tagfile, const std::string& cache_dir)
+    {
+        std::uint64_t mtime = 0;
+        std::uint64_t size = 0;
+        if (!source_stamp(tagfile, mtime, size))
+        {
+            close();
+            return false;
+        }
+
+        std::string index_file = tag_index_path(tagfile, cache_dir);
+        if (open(index_file) && validate(mtime, size))
+        {
+            return true;
+        }
+        close();
+
+        std::vector<char> buffer;
+        if (!build(tagfile, buffer))
+        {
+            return false;
+        }
+
+        // Write to a temporary file first so that concurrent kernels never
+        // map a partially written index.
+        std::error_code ec;
+        fs::create_directories(fs::path(index_file).parent_path(), ec);
+        std::string tmp_file = index_file + "."
+                               + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+        {
+            std::ofstream out(tmp_file, std::ios::binary);
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            ec = out ? std::error_code() : std::make_error_code(std::errc::io_error);
+        }
+        if (!ec)
+        {
+            fs::rename(tmp_file, index_file, ec);
+        }
+        if (ec)
+        {
+            fs::remove(tmp_file, ec);
+            return adopt(std::move(buffer)) && validate(mtime, size);
+        }
+        if (open(index_file) && validate(mtime, size))
+        {
+            return true;
+        }
+        close();
+        return adopt(std::move(buffer)) && validate(mtime, size);
+    }
+
+    bool xtag_index::build(const std::string& tagfile, std::vector<char>& buffer)
+    {
+        index_header header = {};
+        std::memcpy(header.magic, index_magic, sizeof(index_magic));
+        header.version = index_version;
+        if (!source_stamp(tagfile, header.source_mtime, header.source_size))
+        {
+            return false;
+        }
+
+        pugi::xml_document doc;
+        if (!doc.load_file(tagfile.c_str()))
+        {
+            return false;
+        }
+
+        string_pool pool;
+        table_builder tables[table_count];
+        index_children(doc, pool, tables);
+
+        std::vector<std::uint32_t> buckets[table_count];
+        std::size_t offset = align8(sizeof(index_header));
+        for (std::size_t t = 0; t < table_count; ++t)
+        {
+            buckets[t] = tables[t].buckets();
+            header.tables[t].bucket_count = static_cast<std::uint32_t>(buckets[t].size());
+            header.tables[t].bucket_offset = offset;
+            offset = align8(offset + buckets[t].size() * sizeof(std::uint32_t));
+            header.tables[t].entry_count = static_cast<std::uint32_t>(tables[t].entries().size());
+            header.tables[t].entry_offset = offset;
+            offset = align8(offset + tables[t].entries().size() * sizeof(index_entry));
+        }
+        header.strings_offset = offset;
+        header.strings_size = pool.data().size();
+
+        buffer.assign(offset + pool.data().size(), '\0');
+        write_at(buffer, 0, &header, 1);
+        for (std::size_t t = 0; t < table_count; ++t)
+        {
+            write_at(buffer, header.tables[t].bucket_offset, buckets[t].data(), buckets[t].size());
+            write_at(buffer, header.tables[t].entry_offset, tables[t].entries().data(), tables[t].entries().size());
+        }
+        write_at(buffer, header.strings_offset, pool.data().data(), pool.data().size());
+        return true;
+    }
+
+    std::string xtag_index::find(const std::string& kind, const std::string& name) const
+    {
+        return lookup(entity_table, kind, name);
+    }
+
+    std::string xtag_index::find_member(const std::string& class_name, const std::string& member) const
+    {
+        return lookup(member_table, class_name, member);
+    }
+
+    bool xtag_index::empty() const
+    {
+        return p_data == nullptr;
+    }
+
+    bool xtag_index::open(const std::string& index_file)
+    {
+        close();
+#if defined(XEUS_CPP_TAGINDEX_MMAP)
+        int fd = ::open(index_file.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(index_header)))
+        {
+            ::close(fd);
+            return false;
+        }
+        void* data = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+        p_data = static_cast<const char*>(data);
+        m_size = static_cast<std::size_t>(st.st_size);
+        m_mapped = true;
+        return true;
+#else
+        std::ifstream in(index_file, std::ios::binary);
+        if (!in)
+        {
+            return false;
+        }
+        std::vector<char> buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return adopt(std::move(buffer));
+#endif
+    }
+
+    bool xtag_index::adopt(std::vector<char> buffer)
+    {
+        close();
+        if (buffer.size() < sizeof(index_header))
+        {
+            return false;
+        }
+        m_buffer = std::move(buffer);
+        p_data = m_buffer.data();
+        m_size = m_buffer.size();
+        return true;
+    }
+
+    bool xtag_index::validate(std::uint64_t source_mtime, std::uint64_t source_size) const
+    {
+        if (p_data == nullptr || m_size < sizeof(index_header))
+        {
+            return false;
+        }
+        const auto* header = reinterpret_cast<const index_header*>(p_data);
+        if (std::memcmp(header->magic, index_magic, sizeof(index_magic)) != 0
+            || header->version != index_version || header->source_mtime != source_mtime
+            || header->source_size != source_size)
+        {
+            return false;
+        }
+        if (header->strings_offset > m_size || header->strings_size > m_size - header->strings_offset)
+        {
+            return false;
+        }
+        for (const index_table& table : header->tables)
+        {
+            if (table.bucket_count == 0 || (table.bucket_count & (table.bucket_count - 1)) != 0
+                || table.bucket_offset % 8 != 0 || table.entry_offset % 8 != 0
+                || table.bucket_offset + std::uint64_t(table.bucket_count) * sizeof(std::uint32_t) > m_size
+                || table.entry_offset + std::uint64_t(table.entry_count) * sizeof(index_entry) > m_size)
+            {
+                return false;
+            }
+            const auto* buckets = reinterpret_cast<const std::uint32_t*>(p_data + table.bucket_offset);
+            for (std::uint32_t i = 0; i < table.bucket_count; ++i)
+            {
+                if (buckets[i] > table.entry_count)
+                {
+                    return false;
+                }
+            }
+            const auto* entries = reinterpret_cast<const index_entry*>(p_data + table.entry_offset);
+            for (std::uint32_t i = 0; i < table.entry_count; ++i)
+            {
+                const index_entry& e = entries[i];
+                if (std::uint64_t(e.first_offset) + e.first_size > header->strings_size
+                    || std::uint64_t(e.second_offset) + e.second_size > header->strings_size
+                    || std::uint64_t(e.value_offset) + e.value_size > header->strings_size)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void xtag_index::close()
+    {
+#if defined(XEUS_CPP_TAGINDEX_MMAP)
+        if (m_mapped && p_data != nullptr)
+        {
+            ::munmap(const_cast<char*>(p_data), m_size);
+        }
+#endif
+        p_data = nullptr;
+        m_size = 0;
+        m_mapped = false;
+        m_buffer.clear();
+    }
+
+    std::string xtag_index::lookup(std::size_t table_id, const std::string& first, const std::string& second) const
+    {
+        if (empty())
+        {
+            return "";
+        }
+        const auto* header = reinterpret_cast<const index_header*>(p_data);
+        const index_table& table = header->tables[table_id];
+        const auto* buckets = reinterpret_cast<const std::uint32_t*>(p_data + table.bucket_offset);
+        const auto* entries = reinterpret_cast<const index_entry*>(p_data + table.entry_offset);
+        const char* strings = p_data + header->strings_offset;
+
+        const std::uint64_t h = hash_key(first, second);
+        const std::size_t mask = table.bucket_count - 1;
+        std::size_t slot = h & mask;
+        for (std::uint32_t probe = 0; probe < table.bucket_count; ++probe, slot = (slot + 1) & mask)
+        {
+            std::uint32_t index = buckets[slot];
+            if (index == 0)
+            {
+                break;
+            }
+            const index_entry& e = entries[index - 1];
+            if (e.hash == h && e.first_size == first.size() && e.second_size == second.size()
+                && first.compare(0, first.size(), strings + e.first_offset, e.first_size) == 0
+                && second.compare(0, second.size(), strings + e.second_offset, e.second_size) == 0)
+            {
+                return std::string(strings + e.value_offset, e.value_size);
+            }
+        }
+        return "";
+    }
+
+    std::string tag_index_path(const std::string& tagfile, const std::string& cache_dir)
+    {
+        std::error_code ec;
+        std::string source = fs::absolute(tagfile, ec).string();
+        if (ec)
+        {
+            source = tagfile;
+        }
+        const char* digits = "0123456789abcdef";
+        std::uint64_t h = hash_key(source.data(), source.size(), "", 0);
+        std::string name(16, '0');
+        for (std::size_t i = 0; i < 16; ++i)
+        {
+            name[15 - i] = digits[(h >> (4 * i)) & 0xf];
+        }
+        return (fs::path(cache_dir) / "tagindex" / (name + ".idx")).string();
+    }
+}
@@ -0,0 +1,81 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_TAGINDEX_HPP
+#define XEUS_CPP_TAGINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "xeus-cpp/xeus_cpp_config.hpp"
+
+namespace xcpp
+{
+    /**
+     * Compact, read-only index of a doxygen tagfile.
+     *
+     * The index is built once from the XML tagfile and cached on disk next to
+     * the other xeus-cpp caches. It is memory-mapped when opened, so that
+     * lookups are hash table probes into the mapping and never parse XML.
+     *
+     * Two tables are stored:
+     *  - (kind, qualified name) -> documentation file, mirroring the lookup
+     *    done with node_predicate;
+     *  - (class, member function) -> documentation file, mirroring the lookup
+     *    done with class_member_predicate.
+     *
+     * When several nodes share the same key, the first one in document order
+     * wins, which is what pugi::xml_node::find_node returns.
+     */
+    class XEUS_CPP_API xtag_index
+    {
+    public:
+
+        xtag_index() = default;
+        ~xtag_index();
+
+        xtag_index(const xtag_index&) = delete;
+        xtag_index& operator=(const xtag_index&) = delete;
+
+        xtag_index(xtag_index&& rhs) noexcept;
+        xtag_index& operator=(xtag_index&& rhs) noexcept;
+
+        // Opens the index of `tagfile` cached under `cache_dir`. The index
+        // is (re)built when it is missing or older than the tagfile. If the
+        // cache directory is not writable, the index is kept in memory.
+        bool load(const std::string& tagfile, const std::string& cache_dir);
+
+        // Serializes the index of `tagfile` into `buffer`.
+        static bool build(const std::string& tagfile, std::vector<char>& buffer);
+
+        std::string find(const std::string& kind, const std::string& name) const;
+        std::string find_member(const std::string& class_name, const std::string& member) const;
+
+        bool empty() const;
+
+    private:
+
+        bool open(const std::string& index_file);
+        bool adopt(std::vector<char> buffer);
+        bool validate(std::uint64_t source_mtime, std::uint64_t source_size) const;
+        void close();
+
+        std::string lookup(std::size_t table, const std::string& first, const std::string& second) const;
+
+        const char* p_data = nullptr;
+        std::size_t m_size = 0;
+        bool m_mapped = false;
+        std::vector<char> m_buffer;
+    };
+
+    XEUS_CPP_API std::string tag_index_path(const std::string& tagfile, const std::string& cache_dir);
+}
+
+#endif
@@ -7,6 +7,7 @@
  ************************************************************************************/
 
 #include <cstddef>
+#include <filesystem>
 #include <memory>
 #include <string>
 #include <utility>
@@ -87,4 +88,36 @@ namespace xcpp
 
         return prefix + "share" + separator + "xeus-cpp" + separator + "tagfiles";
     }
+
+    std::string retrieve_cache_dir()
+    {
+        const char* cache_dir_env = std::getenv("XCPP_CACHE_DIR");
+        if (cache_dir_env != nullptr)
+        {
+            return cache_dir_env;
+        }
+
+#if defined(_WIN32)
+        const char* local_app_data = std::getenv("LOCALAPPDATA");
+        if (local_app_data != nullptr)
+        {
+            return std::string(local_app_data) + "\\xeus-cpp\\cache";
+        }
+#else
+        const char* xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+        if (xdg_cache_home != nullptr && *xdg_cache_home != '\0')
+        {
+            return std::string(xdg_cache_home) + "/xeus-cpp";
+        }
+        const char* home = std::getenv("HOME");
+        if (home != nullptr && *home != '\0')
+        {
+            return std::string(home) + "/.cache/xeus-cpp";
+        }
+#endif
+
+        std::error_code ec;
+        auto tmp_dir = std::filesystem::temp_directory_path(ec);
+        return (ec ? std::filesystem::path(".") : tmp_dir).append("xeus-cpp").string();
+    }
 }
@@ -0,0 +1,487 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <filesystem>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "xzygote.hpp"
+
+namespace xcpp
+{
+#if !defined(_WIN32)
+    namespace
+    {
+        constexpr std::size_t stdio_count = 3;
+
+        // Number of threads of the process, 0 when it is not known.
+        std::size_t thread_count()
+        {
+#if defined(__linux__)
+            std::error_code ec;
+            std::size_t count = 0;
+            for (std::filesystem::directory_iterator it("/proc/self/task", ec), end; !ec && it != end;
+                 it.increment(ec))
+            {
+                ++count;
+            }
+            return ec ? 0 : count;
+#else
+            return 0;
+#endif
+        }
+
+        // Only the forking thread exists in the child: the state owned by
+        // any other thread, such as held locks, would be left inconsistent
+        // in the kernel.
+        bool can_fork(interpreter& prototype)
+        {
+            prototype.prepare_fork();
+            const std::size_t count = thread_count();
+            if (count > 1)
+            {
+                std::clog << "The zygote cannot fork kernels while it runs " << count << " threads" << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        bool make_address(const std::string& socket_path, sockaddr_un& addr)
+        {
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path))
+            {
+                std::clog << "Invalid zygote socket path: " << socket_path << std::endl;
+                return false;
+            }
+            std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+            return true;
+        }
+
+        bool write_line(int fd, const std::string& line)
+        {
+            std::string data = line + "\n";
+            std::size_t written = 0;
+            while (written < data.size())
+            {
+                ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return false;
+                }
+                written += static_cast<std::size_t>(n);
+            }
+            return true;
+        }
+
+        // Reads the next line from `fd`, `buffer` keeps what was read past it.
+        bool read_line(int fd, std::string& buffer, std::string& line)
+        {
+            std::size_t pos = buffer.find('\n');
+            while (pos == std::string::npos)
+            {
+                char chunk[256];
+                ssize_t n = ::read(fd, chunk, sizeof(chunk));
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return false;
+                }
+                buffer.append(chunk, static_cast<std::size_t>(n));
+                pos = buffer.find('\n');
+            }
+            line = buffer.substr(0, pos);
+            buffer.erase(0, pos + 1);
+            return true;
+        }
+
+        // A request is "<cwd>\0<connection file>\0", with the standard
+        // streams of the client attached as SCM_RIGHTS.
+        bool send_request(int fd, const std::string& payload)
+        {
+            iovec iov;
+            iov.iov_base = const_cast<char*>(payload.data());
+            iov.iov_len = payload.size();
+
+            union
+            {
+                cmsghdr align;
+                char buffer[CMSG_SPACE(sizeof(int) * stdio_count)];
+            } control;
+            std::memset(&control, 0, sizeof(control));
+
+            msghdr msg;
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control.buffer;
+            msg.msg_controllen = sizeof(control.buffer);
+
+            cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * stdio_count);
+            const int stdio[stdio_count] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+            std::memcpy(CMSG_DATA(cmsg), stdio, sizeof(stdio));
+
+            ssize_t n;
+            do
+            {
+                n = ::sendmsg(fd, &msg, 0);
+            } while (n < 0 && errno == EINTR);
+            return n == static_cast<ssize_t>(payload.size());
+        }
+
+        bool receive_request(int fd, std::string& cwd, std::string& connection_file, std::vector<int>& stdio)
+        {
+            std::string payload;
+            char data[4096];
+            iovec iov;
+            iov.iov_base = data;
+            iov.iov_len = sizeof(data);
+
+            union
+            {
+                cmsghdr align;
+                char buffer[CMSG_SPACE(sizeof(int) * stdio_count)];
+            } control;
+            std::memset(&control, 0, sizeof(control));
+
+            msghdr msg;
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control.buffer;
+            msg.msg_controllen = sizeof(control.buffer);
+
+            ssize_t n;
+            do
+            {
+                n = ::recvmsg(fd, &msg, 0);
+            } while (n < 0 && errno == EINTR);
+            if (n <= 0)
+            {
+                return false;
+            }
+            payload.append(data, static_cast<std::size_t>(n));
+
+            for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+                {
+                    std::size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                    std::vector<int> fds(count);
+                    std::memcpy(fds.data(), CMSG_DATA(cmsg), count * sizeof(int));
+                    stdio.insert(stdio.end(), fds.begin(), fds.end());
+                }
+            }
+
+            // The payload may arrive in several reads on a stream socket.
+            while (std::count(payload.begin(), payload.end(), '\0') < 2)
+            {
+                n = ::read(fd, data, sizeof(data));
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (n <= 0)
+                {
+                    return false;
+                }
+                payload.append(data, static_cast<std::size_t>(n));
+            }
+
+            std::size_t sep = payload.find('\0');
+            cwd = payload.substr(0, sep);
+            connection_file = payload.substr(sep + 1, payload.find('\0', sep + 1) - sep - 1);
+            return stdio.size() == stdio_count && !connection_file.empty();
+        }
+
+        int exit_code(int status)
+        {
+            if (WIFEXITED(status))
+            {
+                return WEXITSTATUS(status);
+            }
+            if (WIFSIGNALED(status))
+            {
+                return 128 + WTERMSIG(status);
+            }
+            return 1;
+        }
+
+        volatile sig_atomic_t kernel_pid = 0;
+
+        void forward_signal(int sig)
+        {
+            if (kernel_pid > 0)
+            {
+                ::kill(static_cast<pid_t>(kernel_pid), sig);
+            }
+        }
+    }
+
+    int run_zygote(const std::string& socket_path, std::unique_ptr<interpreter> prototype, const kernel_starter& start)
+    {
+        sockaddr_un addr;
+        if (!make_address(socket_path, addr) || !can_fork(*prototype))
+        {
+            return 1;
+        }
+
+        int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0)
+        {
+            std::clog << "Failed to create the zygote socket: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        // A socket left behind by a previous zygote would make bind fail.
+        ::unlink(socket_path.c_str());
+        if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+            || ::chmod(socket_path.c_str(), S_IRUSR | S_IWUSR) != 0 || ::listen(listen_fd, 16) != 0)
+        {
+            std::clog << "Failed to listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+            ::close(listen_fd);
+            return 1;
+        }
+        std::clog << "xcpp zygote listening on " << socket_path << std::endl;
+
+        // Client connection of each running kernel, -1 once the client is
+        // gone.
+        std::map<pid_t, int> kernels;
+        while (true)
+        {
+            std::vector<pollfd> fds = {{listen_fd, POLLIN, 0}};
+            for (const auto& kernel : kernels)
+            {
+                if (kernel.second >= 0)
+                {
+                    fds.push_back({kernel.second, POLLIN, 0});
+                }
+            }
+
+            int ready = ::poll(fds.data(), fds.size(), 200);
+            if (ready < 0 && errno != EINTR)
+            {
+                std::clog << "Zygote poll failed: " << std::strerror(errno) << std::endl;
+                break;
+            }
+
+            int status = 0;
+            pid_t pid;
+            while ((pid = ::waitpid(-1, &status, WNOHANG)) > 0)
+            {
+                auto it = kernels.find(pid);
+                if (it != kernels.end())
+                {
+                    if (it->second >= 0)
+                    {
+                        write_line(it->second, "exit " + std::to_string(exit_code(status)));
+                        ::close(it->second);
+                    }
+                    kernels.erase(it);
+                }
+            }
+            if (ready <= 0)
+            {
+                continue;
+            }
+
+            // Clients only ever send the request, anything else on their
+            // connection is a hangup: the kernel would be orphaned.
+            for (std::size_t i = 1; i < fds.size(); ++i)
+            {
+                if (fds[i].revents == 0)
+                {
+                    continue;
+                }
+                char c;
+                if (::recv(fds[i].fd, &c, 1, MSG_DONTWAIT) > 0)
+                {
+                    continue;
+                }
+                for (auto& kernel : kernels)
+                {
+                    if (kernel.second == fds[i].fd)
+                    {
+                        ::kill(kernel.first, SIGKILL);
+                        ::close(kernel.second);
+                        kernel.second = -1;
+                    }
+                }
+            }
+
+            if ((fds[0].revents & POLLIN) == 0)
+            {
+                continue;
+            }
+            int client = ::accept(listen_fd, nullptr, nullptr);
+            if (client < 0)
+            {
+                continue;
+            }
+
+            std::string cwd;
+            std::string connection_file;
+            std::vector<int> stdio;
+            if (!receive_request(client, cwd, connection_file, stdio))
+            {
+                std::clog << "Invalid zygote request" << std::endl;
+                std::for_each(stdio.begin(), stdio.end(), ::close);
+                ::close(client);
+                continue;
+            }
+
+            if (!can_fork(*prototype))
+            {
+                std::for_each(stdio.begin(), stdio.end(), ::close);
+                write_line(client, "exit 1");
+                ::close(client);
+                continue;
+            }
+
+            pid = ::fork();
+            if (pid == 0)
+            {
+                ::close(listen_fd);
+                ::close(client);
+                for (const auto& kernel : kernels)
+                {
+                    if (kernel.second >= 0)
+                    {
+                        ::close(kernel.second);
+                    }
+                }
+                for (std::size_t i = 0; i < stdio_count; ++i)
+                {
+                    ::dup2(stdio[i], static_cast<int>(i));
+                    ::close(stdio[i]);
+                }
+                if (!cwd.empty() && ::chdir(cwd.c_str()) != 0)
+                {
+                    std::clog << "Failed to change directory to " << cwd << std::endl;
+                }
+                std::exit(start(std::move(prototype), connection_file));
+            }
+
+            std::for_each(stdio.begin(), stdio.end(), ::close);
+            if (pid < 0)
+            {
+                std::clog << "Failed to fork a kernel: " << std::strerror(errno) << std::endl;
+                write_line(client, "exit 1");
+                ::close(client);
+                continue;
+            }
+            write_line(client, "pid " + std::to_string(pid));
+            kernels[pid] = client;
+        }
+
+        ::close(listen_fd);
+        ::unlink(socket_path.c_str());
+        return 1;
+    }
+
+    int connect_zygote(const std::string& socket_path, const std::string& connection_file)
+    {
+        sockaddr_un addr;
+        if (!make_address(socket_path, addr))
+        {
+            return 1;
+        }
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            std::cerr << "Failed to connect to the xcpp zygote at " << socket_path << ": "
+                      << std::strerror(errno) << std::endl;
+            return 1;
+        }
+
+        char cwd[PATH_MAX];
+        std::string payload = ::getcwd(cwd, sizeof(cwd)) != nullptr ? cwd : "";
+        payload += '\0';
+        payload += connection_file;
+        payload += '\0';
+        if (!send_request(fd, payload))
+        {
+            std::cerr << "Failed to send the request to the xcpp zygote" << std::endl;
+            ::close(fd);
+            return 1;
+        }
+
+        std::string buffer;
+        std::string line;
+        if (!read_line(fd, buffer, line) || line.compare(0, 4, "pid ") != 0)
+        {
+            std::cerr << "The xcpp zygote did not start a kernel" << std::endl;
+            ::close(fd);
+            return 1;
+        }
+        kernel_pid = static_cast<sig_atomic_t>(std::atoi(line.c_str() + 4));
+
+        // Interrupts and shutdowns from Jupyter target this process.
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = forward_signal;
+        sigemptyset(&action.sa_mask);
+        for (int sig : {SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGUSR1, SIGUSR2})
+        {
+            ::sigaction(sig, &action, nullptr);
+        }
+
+        int code = 1;
+        while (read_line(fd, buffer, line))
+        {
+            if (line.compare(0, 5, "exit ") == 0)
+            {
+                code = std::atoi(line.c_str() + 5);
+                break;
+            }
+        }
+        ::close(fd);
+        return code;
+    }
+#else
+    int run_zygote(const std::string&, std::unique_ptr<interpreter>, const kernel_starter&)
+    {
+        std::clog << "The zygote mode is not supported on this platform" << std::endl;
+        return 1;
+    }
+
+    int connect_zygote(const std::string&, const std::string&)
+    {
+        std::clog << "The zygote mode is not supported on this platform" << std::endl;
+        return 1;
+    }
+#endif
+}
@@ -0,0 +1,49 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+#ifndef XEUS_CPP_ZYGOTE_HPP
+#define XEUS_CPP_ZYGOTE_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "xeus-cpp/xinterpreter.hpp"
+
+namespace xcpp
+{
+    // Starts a kernel serving `connection_file` with `interpreter` and
+    // returns the exit status of the process.
+    using kernel_starter = std::function<int(std::unique_ptr<interpreter>, const std::string&)>;
+
+    /**
+     * Zygote mode of the xcpp executable.
+     *
+     * The zygote owns an interpreter initialized once and listens on the
+     * Unix socket `socket_path`. Each client connection carries a connection
+     * file; the zygote forks, and the child starts a kernel with its copy of
+     * the interpreter, so the ZMQ context and sockets are only created after
+     * the fork. The zygote reports the pid and then the exit status of the
+     * kernel to the client, and kills the kernel if the client goes away.
+     * The background threads of the interpreter are stopped before each
+     * fork and restarted by the kernel when it needs them; the zygote
+     * refuses to fork while the process runs other threads.
+     */
+    XEUS_CPP_API int run_zygote(const std::string& socket_path, std::unique_ptr<interpreter> prototype, const kernel_starter& start);
+
+    /**
+     * Client of a zygote, started by Jupyter in place of a kernel.
+     *
+     * It hands its standard streams, working directory and connection file
+     * to the zygote, forwards the signals it receives to the forked kernel,
+     * and exits with the status of the kernel.
+     */
+    XEUS_CPP_API int connect_zygote(const std::string& socket_path, const std::string& connection_file);
+}
+
+#endif
@@ -0,0 +1,120 @@
+/************************************************************************************
+ * Copyright (c) 2025, xeus-cpp contributors                                        *
+ *                                                                                  *
+ * Distributed under the terms of the BSD 3-Clause License.                         *
+ *                                                                                  *
+ * The full license is in the file LICENSE, distributed with this software.         *
+ ************************************************************************************/
+
+// Cost of extracting the token completed at the end of a cell, for cells of
+// increasing size: the former regex split, split_line and token_before.
+//
+// Usage: benchmark_xeus_cpp_parser [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/xparser.hpp"
+
+namespace
+{
+    const std::string delims = " \t\n`!@#$^&*()=+[{]}\\|;:\'\",<>?.";
+
+    // The implementation split_line had before the scanner.
+    std::vector<std::string> regex_split_line(const std::string& input, std::size_t cursor_pos)
+    {
+        std::vector<std::string> result;
+        std::stringstream ss;
+        ss << "[";
+        for (auto c : delims)
+        {
+            ss << "\\" << c;
+        }
+        ss << "]";
+        std::regex re(ss.str());
+        std::copy(
+            std::sregex_token_iterator(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(cursor_pos), re, -1),
+            std::sregex_token_iterator(),
+            std::back_inserter(result)
+        );
+        return result;
+    }
+
+    std::string make_cell(std::size_t size)
+    {
+        const std::string line = "    std::vector<double> values(n, 0.5); total += values[i] * scale;\n";
+        std::string cell;
+        while (cell.size() + line.size() < size)
+        {
+            cell += line;
+        }
+        return cell + "std::vec";
+    }
+
+    template <class F>
+    double time_per_call(std::size_t iterations, F&& f)
+    {
+        std::size_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < iterations; ++i)
+        {
+            sink += f();
+        }
+        auto stop = std::chrono::steady_clock::now();
+        if (sink == 0)
+        {
+            std::cerr << "unexpected empty token\n";
+        }
+        return std::chrono::duration<double, std::micro>(stop - start).count() / static_cast<double>(iterations);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    const xcpp::delimiter_table table(delims);
+
+    std::cout << std::setw(10) << "cell" << std::setw(16) << "regex (us)" << std::setw(16)
+              << "split_line (us)" << std::setw(18) << "token_before (us)" << "\n";
+    for (std::size_t size : {1024u, 16u * 1024u, 256u * 1024u, 1024u * 1024u})
+    {
+        const std::string cell = make_cell(size);
+        const std::size_t cursor = cell.size();
+        // The regex split is too slow for many iterations on large cells.
+        const std::size_t regex_iterations = std::max<std::size_t>(1, iterations * 1024 / size);
+
+        double regex = time_per_call(
+            regex_iterations,
+            [&]()
+            {
+                return regex_split_line(cell, cursor).back().size();
+            }
+        );
+        double split = time_per_call(
+            iterations,
+            [&]()
+            {
+                return xcpp::split_line(cell, delims, cursor).back().size();
+            }
+        );
+        double scan = time_per_call(
+            iterations * 1000,
+            [&]()
+            {
+                return xcpp::token_before(cell, table, cursor).size();
+            }
+        );
+        std::cout << std::setw(10) << cell.size() << std::fixed << std::setprecision(3) << std::setw(16) << regex
+                  << std::setw(16) << split << std::setw(18) << scan << "\n";
+    }
+    return 0;
+}
@@ -6,7 +6,14 @@
  * The full license is in the file LICENSE, distributed with this software.
  ****************************************************************************/
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <functional>
 #include <future>
+#include <mutex>
+#include <thread>
 
 #include "doctest/doctest.h"
 #include "xeus-cpp/xinterpreter.hpp"
@@ -14,19 +21,34 @@
 #include "xeus-cpp/xmanager.hpp"
 #include "xeus-cpp/xutils.hpp"
 #include "xeus-cpp/xoptions.hpp"
+#include "xeus-cpp/xinterrupt.hpp"
 #include "xeus-cpp/xeus_cpp_config.hpp"
 
 #include "../src/xparser.hpp"
 #include "../src/xsystem.hpp"
+#include "../src/xmagics/checkpoint.hpp"
+#include "../src/xmagics/codegen.hpp"
+#include "../src/xmagics/executable.hpp"
+#include "../src/xmagics/execution.hpp"
 #include "../src/xmagics/os.hpp"
 #include "../src/xmagics/xassist.hpp"
+#include "../src/xallocations.hpp"
+#include "../src/xcapture.hpp"
+#include "../src/xcompiler.hpp"
+#include "../src/xcomplete.hpp"
 #include "../src/xinspect.hpp"
+#include "../src/xjournal.hpp"
+#include "../src/xprofiler.hpp"
+#include "../src/xtagindex.hpp"
+#include "../src/xzygote.hpp"
 
 
 #include <iostream>
 #include <pugixml.hpp>
+#include <filesystem>
 #include <fstream>
 #if defined(__GNUC__) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+    #include <signal.h>
     #include <sys/wait.h>
     #include <unistd.h>
 #endif
@@ -304,6 +326,53 @@ TEST_SUITE("is_complete_request")
         std::string code = "int main() {}";
         nl::json result = interpreter.is_complete_request(code);
         REQUIRE(result["status"] == "complete");
+
+        code = "for (int i = 0; i < 3; ++i) {\n    if (i) {";
+        result = interpreter.is_complete_request(code);
+        REQUIRE(result["status"] == "incomplete");
+        REQUIRE(result["indent"] == "        ");
+    }
+
+    TEST_CASE("brackets")
+    {
+        REQUIRE(xcpp::check_completeness("").status == "complete");
+        REQUIRE(xcpp::check_completeness("int x = f(1, g[2]);").status == "complete");
+        REQUIRE(xcpp::check_completeness("void f() {\n").status == "incomplete");
+        REQUIRE(xcpp::check_completeness("void f() {\n").indent == "    ");
+        REQUIRE(xcpp::check_completeness("f(1,\n  g(2,").indent == "      ");
+        REQUIRE(xcpp::check_completeness("int a[] = {1, 2};\n}").status == "invalid");
+        REQUIRE(xcpp::check_completeness("f(1];").status == "invalid");
+        // Brackets in comments, strings and character literals do not count.
+        REQUIRE(xcpp::check_completeness("// {\nauto s = \"(\\\"\"; char c = '{';").status == "complete");
+        REQUIRE(xcpp::check_completeness("int n = 1'000'000; auto f = [](int) {};").status == "complete");
+    }
+
+    TEST_CASE("literals_and_comments")
+    {
+        REQUIRE(xcpp::check_completeness("/* unfinished {").status == "incomplete");
+        REQUIRE(xcpp::check_completeness("/* ( */ int x;").status == "complete");
+        REQUIRE(xcpp::check_completeness("auto s = R\"x(text)\n\"").status == "incomplete");
+        REQUIRE(xcpp::check_completeness("auto s = R\"x(text)\n\"").indent == "");
+        REQUIRE(xcpp::check_completeness("auto s = R\"x(a { \" )\")x\";").status == "complete");
+        REQUIRE(xcpp::check_completeness("auto s = \"unterminated;").status == "invalid");
+    }
+
+    TEST_CASE("preprocessor")
+    {
+        REQUIRE(xcpp::check_completeness("#include <vector>").status == "complete");
+        REQUIRE(xcpp::check_completeness("#ifdef FOO\nint x;\n").status == "incomplete");
+        REQUIRE(xcpp::check_completeness("#if 1\n#if 2\n#endif\n#endif").status == "complete");
+        REQUIRE(xcpp::check_completeness("#endif").status == "invalid");
+        REQUIRE(xcpp::check_completeness("#define BEGIN {\\\n  (\nint x;").status == "complete");
+        // Trailing backslashes continue the line, with its indentation.
+        REQUIRE(xcpp::check_completeness("  int x = \\").status == "incomplete");
+        REQUIRE(xcpp::check_completeness("  int x = \\").indent == "  ");
+        REQUIRE(xcpp::check_completeness("%%file out.txt\n{").status == "complete");
+        // The body of `#if 0` blocks is not code.
+        REQUIRE(xcpp::check_completeness("#if 0\nit's a note {\n#endif").status == "complete");
+        REQUIRE(xcpp::check_completeness("#if 0 // disabled\n#ifdef FOO\n'\n#endif\n#else\nint x;\n#endif").status == "complete");
+        REQUIRE(xcpp::check_completeness("#if 0\n#else\nint x = f(\n#endif").status == "incomplete");
+        REQUIRE(xcpp::check_completeness("#if 0\nit's\n").status == "incomplete");
     }
 }
 
@@ -347,6 +416,32 @@ TEST_SUITE("trim"){
 
 }
 
+TEST_SUITE("split_line")
+{
+    TEST_CASE("token_before")
+    {
+        xcpp::delimiter_table delims(" .:(");
+
+        REQUIRE(xcpp::token_before("std::vec", delims, 8) == "vec");
+        REQUIRE(xcpp::token_before("std::vec", delims, 7) == "ve");
+        REQUIRE(xcpp::token_before("v.", delims, 2) == "");
+        REQUIRE(xcpp::token_before("size", delims, 4) == "size");
+        REQUIRE(xcpp::token_before("", delims, 0) == "");
+        // The cursor is clamped to the input.
+        REQUIRE(xcpp::token_before("f(ab", delims, 10) == "ab");
+    }
+
+    TEST_CASE("split_line")
+    {
+        using tokens = std::vector<std::string>;
+
+        REQUIRE(xcpp::split_line("std::vec", ":", 8) == tokens{"std", "", "vec"});
+        REQUIRE(xcpp::split_line("a b c", " ", 3) == tokens{"a", "b"});
+        REQUIRE(xcpp::split_line("v.", ".", 2) == tokens{"v", ""});
+        REQUIRE(xcpp::split_line("abc", ".", 10) == tokens{"abc"});
+    }
+}
+
 TEST_SUITE("is_match_magics_manager")
 {
     // This test case checks if the function `is_match` correctly identifies strings that match
@@ -509,6 +604,121 @@ TEST_SUITE("xbuffer")
         REQUIRE(output == "");
     }
 
+    // This test case checks that the `xoutput_publisher` coalesces the output
+    // of several streams while preserving its order.
+    TEST_CASE("xoutput_publisher_coalesces_in_order")
+    {
+        std::vector<std::string> published;
+        auto out_callback = [&published](const std::string& value)
+        {
+            published.push_back("out:" + value);
+        };
+        auto err_callback = [&published](const std::string& value)
+        {
+            published.push_back("err:" + value);
+        };
+
+        xcpp::xoutput_publisher publisher(std::chrono::hours(1), std::size_t(1) << 30);
+        xcpp::xoutput_buffer out_buffer(out_callback);
+        xcpp::xoutput_buffer err_buffer(err_callback);
+        out_buffer.set_publisher(&publisher);
+        err_buffer.set_publisher(&publisher);
+        std::ostream out(&out_buffer);
+        std::ostream err(&err_buffer);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            out << i << std::endl;
+        }
+        err << "oops" << std::endl;
+        out << 'x';
+        REQUIRE(published.empty());
+
+        // Unflushed output stays in the put area of its stream.
+        publisher.flush();
+        REQUIRE(published == std::vector<std::string>{"out:0\n1\n2\n", "err:oops\n"});
+
+        out << 'y' << std::string(2 * xcpp::xoutput_buffer::put_area_size, 'z');
+        publisher.flush();
+        REQUIRE(published.size() == 3);
+        REQUIRE(published[2] == "out:xy" + std::string(2 * xcpp::xoutput_buffer::put_area_size, 'z'));
+
+        out << 'w' << std::flush;
+        publisher.flush();
+        REQUIRE(published.back() == "out:w");
+    }
+
+    // This test case checks that the background thread of the
+    // `xoutput_publisher` starts with the first write, publishes once half of
+    // the ring is pending whatever the threshold, and restarts after stop().
+    TEST_CASE("xoutput_publisher_thread")
+    {
+        std::mutex mutex;
+        std::string published;
+        xcpp::xoutput_publisher publisher(std::chrono::hours(1), std::size_t(1) << 30, 4096);
+        std::size_t stream = publisher.register_stream(
+            [&](const std::string& value)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                published += value;
+            }
+        );
+        // Nothing runs before the first write.
+        publisher.stop();
+
+        const std::string chunk(3000, 'a');
+        publisher.write(stream, chunk.data(), chunk.size());
+        auto size = [&]()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return published.size();
+        };
+        for (int i = 0; i < 500 && size() < chunk.size(); ++i)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        REQUIRE(size() == chunk.size());
+
+        publisher.stop();
+        publisher.write(stream, "b", 1);
+        publisher.stop();
+        REQUIRE(size() == chunk.size() + 1);
+    }
+
+    // This test case checks that the `xoutput_limit` publishes the output up to
+    // its budget, spills the rest to a file and reports it once per cell.
+    TEST_CASE("xoutput_limit_spills_to_file")
+    {
+        std::string published;
+        auto callback = [&published](const std::string& value)
+        {
+            published += value;
+        };
+
+        xcpp::xoutput_limit limit(8);
+        limit.publish("0123", callback);
+        limit.publish("456789", callback);
+        limit.publish("abc", callback);
+        REQUIRE(published == "01234567");
+
+        std::string notice = limit.reset();
+        std::string path = notice.substr(notice.find(" to ") + 4);
+        path = path.substr(0, path.find(']'));
+        REQUIRE(notice.find("after 8 bytes") != std::string::npos);
+        REQUIRE(notice.find("5 more bytes") != std::string::npos);
+        {
+            std::ifstream spilled(path);
+            std::string content((std::istreambuf_iterator<char>(spilled)), std::istreambuf_iterator<char>());
+            REQUIRE(content == "89abc");
+        }
+        std::filesystem::remove(path);
+
+        published.clear();
+        limit.publish("xyz", callback);
+        REQUIRE(published == "xyz");
+        REQUIRE(limit.reset().empty());
+    }
+
     // This test case checks if the `xnull` correctly discards the output.
     // It sets up a scenario where the `xnull` is given some output, then checks
     // if the output is correctly discarded and not stored or returned.
@@ -550,6 +760,60 @@ TEST_SUITE("xoptions")
         }
         REQUIRE(exceptionThrown);
     }
+
+    TEST_CASE("extract_kernel_options") {
+        std::vector<const char*> args = {"-std=c++20", "--prelude", "vector", "-O2", "--prelude=map",
+                                         "--rediscover-compiler-paths"};
+
+        xcpp::kernel_options options = xcpp::extract_kernel_options(args);
+
+        REQUIRE(options.prelude == std::vector<std::string>{"vector", "map"});
+        REQUIRE(options.rediscover_compiler_paths);
+        REQUIRE(args.size() == 2);
+        REQUIRE(std::string(args[0]) == "-std=c++20");
+        REQUIRE(std::string(args[1]) == "-O2");
+    }
+
+    TEST_CASE("std_version_from_args") {
+        REQUIRE(xcpp::std_version_from_args({"-v", "-std=c++23"}) == "23");
+        REQUIRE(xcpp::std_version_from_args({"-std=c++17", "-O2", "-std=gnu++2a"}) == "20");
+        REQUIRE(xcpp::std_version_from_args({"--std=c++1y"}) == "14");
+        REQUIRE(xcpp::std_version_from_args({"-xc", "-std=c17"}) == "");
+        REQUIRE(xcpp::std_version_from_args({"-std=gnu17"}) == "");
+        REQUIRE(xcpp::std_version_from_args({"-std=iso9899:2011"}) == "");
+        REQUIRE(xcpp::std_version_from_args({"-std=c++2x"}) == "");
+        REQUIRE(xcpp::std_version_from_args({"-std=c++98"}) == "");
+        REQUIRE(xcpp::std_version_from_args({"-std=c++2024"}) == "");
+        REQUIRE(xcpp::std_version_from_args({"-O2"}) == "");
+    }
+
+    TEST_CASE("jit_opt_level") {
+        std::vector<const char*> args = {"--jit-opt-level", "3", "-O2"};
+        REQUIRE(xcpp::extract_kernel_options(args).jit_opt_level == "3");
+        REQUIRE(args.size() == 1);
+
+        args = {"--jit-opt-level=fast"};
+        REQUIRE(xcpp::extract_kernel_options(args).jit_opt_level == "");
+
+        args = {"--enable-opt-magic", "-std=c++17"};
+        REQUIRE(xcpp::extract_kernel_options(args).enable_opt_magic);
+        REQUIRE(args.size() == 1);
+        args = {"-std=c++17"};
+        REQUIRE_FALSE(xcpp::extract_kernel_options(args).enable_opt_magic);
+
+        REQUIRE(xcpp::opt_level_from_args({"-O2", "-v", "-Os"}) == "s");
+        REQUIRE(xcpp::opt_level_from_args({"-O"}) == "1");
+        REQUIRE(xcpp::opt_level_from_args({"-v"}) == "");
+    }
+
+    TEST_CASE("complete_timeout") {
+        std::vector<const char*> args = {"--complete-timeout", "250", "-std=c++17"};
+        REQUIRE(xcpp::extract_kernel_options(args).complete_timeout == 250);
+        REQUIRE(args.size() == 1);
+
+        args = {};
+        REQUIRE(xcpp::extract_kernel_options(args).complete_timeout == 0);
+    }
 }
 
 TEST_SUITE("os")
@@ -617,6 +881,461 @@ TEST_SUITE("os")
 
 }
 
+TEST_SUITE("checkpoint")
+{
+    TEST_CASE("rollback_undoes_cells")
+    {
+        std::vector<const char*> Args = {};
+        xcpp::interpreter interpreter((int)Args.size(), Args.data());
+
+        auto execute = [&interpreter](const std::string& code)
+        {
+            xeus::execute_request_config config;
+            config.silent = false;
+            config.store_history = false;
+            config.allow_stdin = false;
+            nl::json header = nl::json::object();
+            xeus::xrequest_context::guid_list id = {};
+            xeus::xrequest_context context(header, id);
+
+            std::promise<nl::json> promise;
+            std::future<nl::json> future = promise.get_future();
+            auto callback = [&promise](nl::json result) {
+                promise.set_value(result);
+            };
+            interpreter.execute_request(
+                std::move(context),
+                std::move(callback),
+                code,
+                std::move(config),
+                nl::json::object()
+            );
+            return future.get();
+        };
+
+        REQUIRE(execute("%checkpoint before")["status"] == "ok");
+        std::size_t size = xcpp::get_journal().size();
+        REQUIRE(execute("int checkpoint_value = 1;")["status"] == "ok");
+        REQUIRE(execute("int checkpoint_value = 2;")["status"] == "error");
+        REQUIRE(xcpp::get_journal().size() == size + 1);
+
+        REQUIRE(execute("%rollback before")["status"] == "ok");
+        REQUIRE(xcpp::get_journal().size() == size);
+        REQUIRE(execute("int checkpoint_value = 2;")["status"] == "ok");
+
+        // Unknown checkpoints are reported and leave the session untouched.
+        execute("%rollback unknown");
+        REQUIRE(xcpp::get_journal().size() == size + 1);
+
+        // A cell failing after it was parsed keeps its transaction, which
+        // is journaled and undone as well.
+        REQUIRE(execute("%checkpoint unresolved")["status"] == "ok");
+        REQUIRE(execute("extern int checkpoint_missing; int checkpoint_use = checkpoint_missing;")["status"] == "error");
+        REQUIRE(xcpp::get_journal().size() == size + 2);
+        REQUIRE_FALSE(xcpp::get_journal().entries().back().completed);
+        REQUIRE(execute("%rollback unresolved")["status"] == "ok");
+        REQUIRE(xcpp::get_journal().size() == size + 1);
+        REQUIRE(Cpp::GetNamed("checkpoint_value") != nullptr);
+        REQUIRE(Cpp::GetNamed("checkpoint_use") == nullptr);
+    }
+}
+
+TEST_SUITE("timeit")
+{
+    TEST_CASE("statistics")
+    {
+        xcpp::timeit_statistics stats = xcpp::compute_timeit_statistics({4.0, 1.0, 3.0, 2.0});
+        REQUIRE(stats.mean == doctest::Approx(2.5));
+        REQUIRE(stats.median == doctest::Approx(2.5));
+        REQUIRE(stats.min == doctest::Approx(1.0));
+        REQUIRE(stats.stddev == doctest::Approx(std::sqrt(1.25)));
+
+        stats = xcpp::compute_timeit_statistics({3.0, 1.0, 2.0});
+        REQUIRE(stats.median == doctest::Approx(2.0));
+    }
+
+    TEST_CASE("format_duration")
+    {
+        REQUIRE(xcpp::format_timeit_duration(1.5, 3) == "1.5 s");
+        REQUIRE(xcpp::format_timeit_duration(0.00123, 3) == "1.23 ms");
+        REQUIRE(xcpp::format_timeit_duration(2e-9, 3) == "2 ns");
+    }
+
+    TEST_CASE("timeit_line_and_cell")
+    {
+        std::vector<const char*> Args = {};
+        xcpp::interpreter interpreter((int)Args.size(), Args.data());
+        xcpp::timeit t;
+
+        StreamRedirectRAII redirect(std::cout);
+        t("timeit -n 10 -r 3 1 + 1");
+        t("timeit -n 10 -r 2", "int x = 1;\nx += 1;");
+        std::string output = redirect.getCaptured();
+        REQUIRE(output.find("mean ± std. dev. of 3 runs, 10 loops each") != std::string::npos);
+        REQUIRE(output.find("mean ± std. dev. of 2 runs, 10 loops each") != std::string::npos);
+    }
+}
+
+TEST_SUITE("opt")
+{
+    TEST_CASE("wrap_cell")
+    {
+        xcpp::opt unoptimized("2", false);
+        xcpp::opt::wrapped_cell wrapped = unoptimized.wrap_cell("opt -O3 -march=skylake -mno-avx512f", "int f();");
+        REQUIRE(wrapped.code.find("#pragma clang optimize on\n") == 0);
+        REQUIRE(wrapped.code.find("target(\"arch=skylake,no-avx512f\")") != std::string::npos);
+        REQUIRE(wrapped.code.find("int f();") != std::string::npos);
+        REQUIRE(wrapped.epilogue == "#pragma clang attribute pop\n#pragma clang optimize off\n");
+
+        xcpp::opt optimized("2", true);
+        REQUIRE(optimized.wrap_cell("opt", "int f();").code == "int f();");
+        REQUIRE(optimized.wrap_cell("opt", "int f();").epilogue.empty());
+        REQUIRE(optimized.wrap_cell("opt -O0", "int f();").code.find("#pragma clang optimize off\n") == 0);
+        REQUIRE_THROWS(optimized.wrap_cell("opt --bogus", "int f();"));
+    }
+
+    TEST_CASE("restores_pragmas_after_errors")
+    {
+        std::vector<const char*> Args = {"--enable-opt-magic"};
+        xcpp::interpreter interpreter((int)Args.size(), Args.data());
+
+        xeus::execute_request_config config;
+        config.silent = false;
+        config.store_history = false;
+        config.allow_stdin = false;
+        nl::json header = nl::json::object();
+        xeus::xrequest_context::guid_list id = {};
+        xeus::xrequest_context context(header, id);
+        std::promise<nl::json> promise;
+        std::future<nl::json> future = promise.get_future();
+        interpreter.execute_request(
+            std::move(context),
+            [&promise](nl::json result) { promise.set_value(result); },
+            "%%opt -march=x86-64\n#include \"xcpp_missing_header.h\"",
+            std::move(config),
+            nl::json::object()
+        );
+        REQUIRE(future.get()["status"] == "error");
+
+        // The fatal error stops the parsing of the cell, the pragmas are
+        // restored by an input of their own.
+        const xcpp::xjournal::entry& last = xcpp::get_journal().entries().back();
+        REQUIRE(last.code == "#pragma clang attribute pop\n#pragma clang optimize off\n");
+        REQUIRE(last.completed);
+        REQUIRE(last.internal);
+    }
+}
+
+TEST_SUITE("executable")
+{
+    TEST_CASE("generate_source")
+    {
+        xcpp::xjournal& journal = xcpp::get_journal();
+        std::size_t size = journal.size();
+        journal.record("int executable_value = 42;");
+        journal.record("while (true) {}", false);
+        journal.record("using __Xeus_GetType_0 = int;", true, true);
+
+        xcpp::executable exe({});
+        std::string source = exe.generate_source("return executable_value;");
+        journal.truncate(size);
+
+        REQUIRE(source.find("int executable_value = 42;") != std::string::npos);
+        REQUIRE(source.find("while (true)") == std::string::npos);
+        REQUIRE(source.find("__Xeus_GetType_0") == std::string::npos);
+        REQUIRE(source.find("int main(int argc, char** argv)\n{\nreturn executable_value;\n}\n") != std::string::npos);
+    }
+}
+
+TEST_SUITE("codegen")
+{
+    TEST_CASE("extract_assembly")
+    {
+        std::string code = "\t.text\n"
+                           "\t.globl\t_Z3fooi\n"
+                           "_Z3fooi:\n"
+                           "\t.cfi_startproc\n"
+                           "\tleal\t1(%rdi), %eax # inc\n"
+                           "\tretq\n"
+                           ".Lfunc_end0:\n"
+                           "\t.cfi_endproc\n"
+                           "value:\n"
+                           "\t.long\t4\n"
+                           "main:\n"
+                           "\t.cfi_startproc\n"
+                           "\txorl\t%eax, %eax\n"
+                           "\tretq\n"
+                           ".Lfunc_end1:\n";
+
+        std::string foo = xcpp::extract_function(code, "foo", false);
+        REQUIRE(foo == "_Z3fooi:\n\tleal\t1(%rdi), %eax # inc\n\tretq\n\n");
+
+        std::string all = xcpp::extract_function(code, "", false);
+        REQUIRE(all.find("main:") != std::string::npos);
+        REQUIRE(all.find("value:") == std::string::npos);
+        REQUIRE(all.find(".cfi_startproc") == std::string::npos);
+    }
+
+    TEST_CASE("extract_llvm_ir")
+    {
+        std::string code = "define i32 @_Z3fooi(i32 %x) {\n"
+                           "entry:\n"
+                           "  %add = add i32 %x, 1\n"
+                           "  ret i32 %add\n"
+                           "}\n"
+                           "\n"
+                           "define i32 @main() {\n"
+                           "  ret i32 0\n"
+                           "}\n";
+
+        std::string foo = xcpp::extract_function(code, "foo", true);
+        REQUIRE(foo.find("@_Z3fooi") != std::string::npos);
+        REQUIRE(foo.find("@main") == std::string::npos);
+        REQUIRE(xcpp::extract_function(code, "bar", true).empty());
+    }
+
+    TEST_CASE("extract_function_of_file")
+    {
+        std::string code = "\t.file\t\"/home/user\" \"input_line_3\"\n"
+                           "\t.file\t1 \"/home/user\" \"cell\"\n"
+                           "\t.file\t2 \"/usr/include/c++/12\" \"bits/stl_vector.h\"\n"
+                           "\t.globl\t_Z3addii\n"
+                           "_Z3addii:\n"
+                           ".Lfunc_begin0:\n"
+                           "\t.loc\t1 1 0\n"
+                           "\t.cfi_startproc\n"
+                           ".Ltmp0:\n"
+                           "\tleal\t(%rdi,%rsi), %eax\n"
+                           "\tretq\n"
+                           ".Lfunc_end0:\n"
+                           "\t.cfi_endproc\n"
+                           "_Z13add_somethingv:\n"
+                           "\t.cfi_startproc\n"
+                           "\t.loc\t2 12 0\n"
+                           "\txorl\t%eax, %eax\n"
+                           "\tretq\n"
+                           ".Lfunc_end1:\n"
+                           "\t.cfi_endproc\n";
+
+        std::string cell = xcpp::extract_function(code, "", false, "cell");
+        REQUIRE(cell == "_Z3addii:\n\tleal\t(%rdi,%rsi), %eax\n\tretq\n\n");
+        REQUIRE(xcpp::extract_function(code, "", false).find("_Z13add_somethingv:") != std::string::npos);
+        REQUIRE(xcpp::extract_function(code, "add", false) == cell);
+
+        std::string ir = "define i32 @_Z3addii(i32 %a, i32 %b) !dbg !10 {\n"
+                         "  %add = add i32 %a, %b, !dbg !12\n"
+                         "  ret i32 %add, !dbg !12\n"
+                         "}\n"
+                         "\n"
+                         "define i32 @_Z13add_somethingv() !dbg !20 {\n"
+                         "  ret i32 0, !dbg !21\n"
+                         "}\n"
+                         "\n"
+                         "!1 = !DIFile(filename: \"cell\", directory: \"/home/user\")\n"
+                         "!2 = !DIFile(filename: \"/usr/include/c++/12/bits/stl_vector.h\", directory: \"/home/user\")\n"
+                         "!10 = distinct !DISubprogram(name: \"add\", scope: !1, file: !1, line: 1, unit: !0)\n"
+                         "!20 = distinct !DISubprogram(name: \"add_something\", scope: !2, file: !2, line: 12, unit: !0)\n";
+
+        std::string cell_ir = xcpp::extract_function(ir, "", true, "cell");
+        REQUIRE(cell_ir == "define i32 @_Z3addii(i32 %a, i32 %b) {\n"
+                           "  %add = add i32 %a, %b\n"
+                           "  ret i32 %add\n"
+                           "}\n"
+                           "\n");
+        REQUIRE(xcpp::extract_function(ir, "add", true) == cell_ir);
+    }
+
+    TEST_CASE("highlight")
+    {
+        std::string html = xcpp::highlight_code_html("  %add = add i32 %x, 1 ; <comment>\n", true);
+        REQUIRE(html.find("<span style=\"color:#d73a49\">add</span>") != std::string::npos);
+        REQUIRE(html.find("&lt;comment&gt;") != std::string::npos);
+    }
+}
+
+TEST_SUITE("perfstat")
+{
+    TEST_CASE("rows")
+    {
+        std::vector<xcpp::counter_reading> readings = {
+            {"cycles", 2000000, 1, true},
+            {"instructions", 3000000, 1, true},
+            {"branches", 1000, 0.5, true},
+            {"branch-misses", 25, 0.5, true},
+            {"LLC-load-misses", 0, 0, false},
+            {"task-clock", 1500000, 1, true}
+        };
+        auto rows = xcpp::perfstat_rows(readings);
+        REQUIRE(rows.size() == 6);
+        REQUIRE(rows[0] == std::vector<std::string>{"cycles", "2,000,000", ""});
+        REQUIRE(rows[1][2] == "1.50 insn per cycle");
+        REQUIRE(rows[3][2] == "2.50% of all branches (50.00%)");
+        REQUIRE(rows[4][1] == "<not supported>");
+        REQUIRE(rows[5][1] == "1.50 ms");
+    }
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+    TEST_CASE("software_events")
+    {
+        // Hardware events may not be available, the task clock always is.
+        xcpp::xcounters counters;
+        counters.enable();
+        volatile double sum = 0;
+        auto start = std::clock();
+        while (std::clock() - start < CLOCKS_PER_SEC / 20)
+        {
+            sum = sum + 1;
+        }
+        counters.disable();
+
+        bool found = false;
+        for (const xcpp::counter_reading& r : counters.read())
+        {
+            if (r.name == "task-clock")
+            {
+                found = true;
+                REQUIRE(r.supported);
+                REQUIRE(r.value > 1e7);
+            }
+        }
+        REQUIRE(found);
+    }
+
+    TEST_CASE("earlier_threads")
+    {
+        // Threads started before the counters are first enabled are not
+        // counted.
+        xcpp::xcounters counters;
+        std::atomic<bool> done(false);
+        std::thread spinner(
+            [&done]()
+            {
+                while (!done.load())
+                {
+                }
+            }
+        );
+        counters.enable();
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(50))
+        {
+        }
+        counters.disable();
+        done = true;
+        spinner.join();
+
+        for (const xcpp::counter_reading& r : counters.read())
+        {
+            if (r.name == "task-clock")
+            {
+                REQUIRE(r.value < 8e7);
+            }
+        }
+    }
+#endif
+}
+
+TEST_SUITE("memprof")
+{
+    TEST_CASE("format_bytes")
+    {
+        REQUIRE(xcpp::format_bytes(0) == "0 B");
+        REQUIRE(xcpp::format_bytes(1023) == "1023 B");
+        REQUIRE(xcpp::format_bytes(1536) == "1.50 KiB");
+        REQUIRE(xcpp::format_bytes(3 * 1024 * 1024) == "3.00 MiB");
+    }
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+    TEST_CASE("tracks_jit_allocations")
+    {
+        std::vector<const char*> Args = {};
+        xcpp::interpreter interpreter((int)Args.size(), Args.data());
+
+        auto execute = [&interpreter](const std::string& code)
+        {
+            xeus::execute_request_config config;
+            config.silent = false;
+            config.store_history = false;
+            config.allow_stdin = false;
+            nl::json header = nl::json::object();
+            xeus::xrequest_context::guid_list id = {};
+            xeus::xrequest_context context(header, id);
+
+            std::promise<nl::json> promise;
+            std::future<nl::json> future = promise.get_future();
+            auto callback = [&promise](nl::json result) {
+                promise.set_value(result);
+            };
+            interpreter.execute_request(
+                std::move(context),
+                std::move(callback),
+                code,
+                std::move(config),
+                nl::json::object()
+            );
+            return future.get();
+        };
+
+        REQUIRE(execute("int* memprof_allocate() { return new int[100]; }")["status"] == "ok");
+
+        xcpp::start_allocation_tracking();
+        REQUIRE(execute("int* memprof_p = memprof_allocate(); delete[] memprof_p;")["status"] == "ok");
+        xcpp::allocation_stats stats = xcpp::stop_allocation_tracking();
+
+        REQUIRE(stats.allocations == 1);
+        REQUIRE(stats.frees == 1);
+        REQUIRE(stats.bytes == 400);
+        REQUIRE(stats.peak_bytes >= 400);
+        REQUIRE(stats.live_bytes == 0);
+        REQUIRE(stats.sites.size() == 1);
+    }
+#endif
+}
+
+TEST_SUITE("prof")
+{
+    TEST_CASE("flame_graph")
+    {
+        xcpp::folded_stacks stacks = {
+            {{"cell", "compute(int)"}, 3},
+            {{"cell", "compute(int)", "std::vector<int>::push_back"}, 1}
+        };
+        std::string svg = xcpp::render_flame_graph(stacks, "4 samples");
+        REQUIRE(svg.rfind("<svg", 0) == 0);
+        REQUIRE(svg.find("<title>all (4 samples, 100.00%)</title>") != std::string::npos);
+        REQUIRE(svg.find("<title>compute(int) (4 samples, 100.00%)</title>") != std::string::npos);
+        REQUIRE(svg.find("<title>std::vector&lt;int&gt;::push_back (1 samples, 25.00%)</title>") != std::string::npos);
+        REQUIRE(svg.find("push_back<") == std::string::npos);
+    }
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+    TEST_CASE("sampling")
+    {
+        xcpp::xprofiler profiler(1000);
+        REQUIRE(profiler.start());
+        // A second profiler cannot run at the same time.
+        xcpp::xprofiler other;
+        REQUIRE_FALSE(other.start());
+
+        volatile double sum = 0;
+        auto start = std::clock();
+        while (std::clock() - start < CLOCKS_PER_SEC / 5)
+        {
+            sum = sum + 1;
+        }
+        profiler.stop();
+
+        auto samples = profiler.samples();
+        REQUIRE(samples.size() > 10);
+        REQUIRE(profiler.dropped() == 0);
+
+        xcpp::xsymbolizer symbols;
+        REQUIRE_FALSE(symbols.is_jit(samples.front().front()));
+        REQUIRE_FALSE(symbols.name(samples.front().front()).empty());
+    }
+#endif
+}
+
 TEST_SUITE("xsystem_clone")
 {
     TEST_CASE("clone_xsystem_not_null")
@@ -815,6 +1534,147 @@ TEST_SUITE("complete_request")
             }
         }
         REQUIRE(found == 2);
+        REQUIRE(result["metadata"]["_jupyter_types_experimental"].size() == result["matches"].size());
+    }
+
+    TEST_CASE("match_score")
+    {
+        REQUIRE(xcpp::match_score("size", "size") > xcpp::match_score("size_type", "size"));
+        REQUIRE(xcpp::match_score("size_type", "size") > xcpp::match_score("Size", "size"));
+        REQUIRE(xcpp::match_score("Size", "size") > xcpp::match_score("unique_ptr", "uptr"));
+        REQUIRE(xcpp::match_score("unique_ptr", "uptr") > 0);
+        REQUIRE(xcpp::match_score("make_shared", "mks") > 0);
+        REQUIRE(xcpp::match_score("getValue", "gv") > 0);
+        REQUIRE(xcpp::match_score("anything", "") > 0);
+        // The first character starts a word.
+        REQUIRE(xcpp::match_score("push_back", "s") == 0);
+        REQUIRE(xcpp::match_score("map", "v") == 0);
+        REQUIRE(xcpp::match_score("vector", "vecc") == 0);
+    }
+
+    TEST_CASE("rank_completions")
+    {
+        auto describe = [](const std::string& name)
+        {
+            if (name == "vector_value")
+            {
+                return xcpp::completion_item{name, "instance", "std::vector<int>"};
+            }
+            if (name == "vector")
+            {
+                return xcpp::completion_item{name, "class", ""};
+            }
+            return xcpp::completion_item{name, "function", "void " + name + "()"};
+        };
+        auto recency = [](const std::string& name)
+        {
+            return name == "vector_value" ? 1. : 0.;
+        };
+
+        std::vector<std::string> candidates = {"valarray", "vector_value", "visit", "vector", "map", "vector"};
+        std::vector<xcpp::completion_item> items = xcpp::rank_completions(candidates, "vector", describe, recency);
+        REQUIRE(items.size() == 2);
+        REQUIRE(items[0].text == "vector");
+        REQUIRE(items[1].text == "vector_value");
+        REQUIRE(items[1].type == "instance");
+        REQUIRE(items[1].signature == "std::vector<int>");
+
+        // The names used by the session come first, after exact matches.
+        items = xcpp::rank_completions(candidates, "v", describe, recency);
+        REQUIRE(items.size() == 4);
+        REQUIRE(items[0].text == "vector_value");
+        REQUIRE(items[1].text == "visit");
+
+        // The names declared by the kernel itself are not offered.
+        candidates = {"__xcpp_transaction_0", "__xcpp_transaction_1", "transform"};
+        items = xcpp::rank_completions(candidates, "tr", describe, recency);
+        REQUIRE(items.size() == 1);
+        REQUIRE(items[0].text == "transform");
+        REQUIRE(xcpp::rank_completions(candidates, "xc", describe, recency).empty());
+
+        // Only the best candidates are described.
+        std::size_t described = 0;
+        auto counting = [&describe, &described](const std::string& name)
+        {
+            ++described;
+            return describe(name);
+        };
+        candidates = {"valarray", "vector_value", "visit", "vector", "map"};
+        items = xcpp::rank_completions(candidates, "", counting, recency, 2);
+        REQUIRE(described == 2);
+        REQUIRE(items.size() == 5);
+        REQUIRE(items[0].text == "vector_value");
+        REQUIRE(items[0].type == "instance");
+        REQUIRE(items[4].type == "<unknown>");
+    }
+
+    TEST_CASE("completion_cache")
+    {
+        std::size_t calls = 0;
+        xcpp::xcompletion_cache cache(
+            [&calls](const std::string&)
+            {
+                ++calls;
+                return std::vector<std::string>{"vector", "valarray", "variant", "map"};
+            },
+            2
+        );
+
+        using candidates = std::vector<std::string>;
+        REQUIRE(cache.complete("std::", "v") == candidates{"vector", "valarray", "variant"});
+        REQUIRE(cache.complete("std::", "va") == candidates{"valarray", "variant"});
+        REQUIRE(cache.complete("std::", "") == candidates{"vector", "valarray", "variant", "map"});
+        REQUIRE(calls == 1);
+        REQUIRE(cache.misses() == 1);
+
+        cache.complete("int x; std::", "m");
+        REQUIRE(calls == 2);
+        cache.complete("std::", "m");
+        REQUIRE(calls == 2);
+
+        // Least recently used contexts are evicted.
+        cache.complete("auto y = std::", "m");
+        cache.complete("int x; std::", "m");
+        REQUIRE(calls == 4);
+
+        // New declarations invalidate the candidates.
+        xcpp::xjournal& journal = xcpp::get_journal();
+        std::size_t size = journal.size();
+        journal.record("int completion_cache_value;");
+        cache.complete("auto y = std::", "m");
+        REQUIRE(calls == 5);
+        journal.truncate(size);
+        cache.complete("auto y = std::", "m");
+        REQUIRE(calls == 6);
+    }
+
+    TEST_CASE("completion_budget")
+    {
+        std::atomic<std::size_t> calls(0);
+        xcpp::xcompletion_cache cache(
+            [&calls](const std::string& code)
+            {
+                ++calls;
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                return code.empty() ? std::vector<std::string>{"static", "struct"}
+                                    : std::vector<std::string>{"size", "push_back"};
+            }
+        );
+        const auto budget = std::chrono::milliseconds(10);
+
+        // Out of time, without anything computed before.
+        REQUIRE(cache.complete("", "s", budget).empty());
+        // The next keystroke joins the parse in progress.
+        REQUIRE(cache.complete("", "st", budget).empty());
+        cache.wait_idle();
+        REQUIRE(calls == 1);
+        REQUIRE(cache.complete("", "st", budget) == std::vector<std::string>{"static", "struct"});
+
+        // Members are not completed with the candidates of another context.
+        REQUIRE(cache.complete("v.", "s", budget).empty());
+        cache.wait_idle();
+        REQUIRE(cache.complete("v.", "s", budget) == std::vector<std::string>{"size"});
+        REQUIRE(calls == 2);
     }
 }
 
@@ -880,6 +1740,384 @@ TEST_SUITE("xinspect"){
 
 }
 
+TEST_SUITE("xtag_index"){
+    TEST_CASE("find_and_find_member"){
+        std::string tagfile = "xtag_index_test.tag";
+        std::string cache_dir = "xtag_index_test_cache";
+        {
+            std::ofstream out(tagfile);
+            out << R"(<?xml version="1.0" encoding="UTF-8" standalone="yes" ?>
+<tagfile>
+  <compound kind="class">
+    <name>std::vector</name>
+    <filename>cpp/container/vector</filename>
+    <member kind="function">
+      <name>push_back</name>
+      <anchorfile>cpp/container/vector/push_back</anchorfile>
+    </member>
+  </compound>
+  <compound kind="function">
+    <name>std::sort</name>
+    <anchorfile>cpp/algorithm/sort</anchorfile>
+  </compound>
+  <compound kind="class">
+    <name>std::vector</name>
+    <filename>cpp/container/duplicate</filename>
+  </compound>
+</tagfile>
+)";
+        }
+
+        xcpp::xtag_index index;
+        REQUIRE(index.load(tagfile, cache_dir));
+        REQUIRE(index.find("class", "std::vector") == "cpp/container/vector");
+        REQUIRE(index.find("function", "std::sort") == "cpp/algorithm/sort");
+        REQUIRE(index.find("struct", "std::vector") == "");
+        REQUIRE(index.find_member("std::vector", "push_back") == "cpp/container/vector/push_back");
+        REQUIRE(index.find_member("std::vector", "emplace_back") == "");
+
+        // The second load maps the cached index instead of rebuilding it.
+        xcpp::xtag_index cached;
+        REQUIRE(cached.load(tagfile, cache_dir));
+        REQUIRE(cached.find("class", "std::vector") == "cpp/container/vector");
+
+        std::filesystem::remove(tagfile);
+        std::filesystem::remove_all(cache_dir);
+    }
+
+    TEST_CASE("missing_tagfile"){
+        xcpp::xtag_index index;
+        REQUIRE(index.load("nonexistent.tag", "xtag_index_test_cache") == false);
+        REQUIRE(index.empty());
+        REQUIRE(index.find("class", "std::vector") == "");
+    }
+}
+
+TEST_SUITE("xdoc_catalog"){
+    TEST_CASE("picks_up_new_tagconfs"){
+        namespace fs = std::filesystem;
+        fs::path root = "xdoc_catalog_test";
+        fs::create_directories(root / "tags.d");
+        fs::create_directories(root / "tagfiles");
+        {
+            std::ofstream out(root / "tagfiles" / "lib.tag");
+            out << R"(<tagfile><compound kind="class"><name>lib::widget</name>)"
+                << R"(<filename>widget.html</filename></compound></tagfile>)";
+        }
+
+        xcpp::xdoc_catalog catalog(
+            (root / "tags.d").string(),
+            (root / "tagfiles").string(),
+            (root / "cache").string(),
+            std::chrono::seconds(0)
+        );
+        REQUIRE(catalog.sources().empty());
+
+        {
+            std::ofstream out(root / "tags.d" / "lib.json");
+            out << R"({"url": "https://lib.example/", "tagfile": "lib.tag"})";
+        }
+        // Make sure the directory timestamp moves even on coarse filesystems.
+        fs::last_write_time(root / "tags.d", fs::file_time_type::clock::now() + std::chrono::seconds(2));
+
+        const auto& sources = catalog.sources();
+        REQUIRE(sources.size() == 1);
+        REQUIRE(sources[0].url == "https://lib.example/");
+        REQUIRE(sources[0].index.find("class", "lib::widget") == "widget.html");
+
+        fs::remove_all(root);
+    }
+}
+
+#if !defined(_WIN32) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+TEST_SUITE("xcapture"){
+    TEST_CASE("forwards_native_output"){
+        std::stringbuf out;
+        std::stringbuf err;
+        std::string captured;
+        {
+            xcpp::xfd_capture capture(&out, &err);
+            std::printf("printf %d\n", 42);
+            std::fprintf(stderr, "fprintf\n");
+            capture.stop();
+            captured = capture.captured_stderr();
+        }
+        REQUIRE(out.str() == "printf 42\n");
+        REQUIRE(err.str() == "fprintf\n");
+        REQUIRE(captured == "fprintf\n");
+    }
+}
+#endif
+
+#if !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+TEST_SUITE("xcompiler"){
+    TEST_CASE("compiler_paths_are_cached"){
+        namespace fs = std::filesystem;
+        fs::path cache_dir = fs::temp_directory_path() / "xcompiler_paths_test";
+        fs::remove_all(cache_dir);
+
+        xcpp::compiler_paths detected = xcpp::detect_compiler_paths(cache_dir.string());
+        if (!detected.resource_dir.empty() && !xcpp::find_program("clang").empty()
+            && !xcpp::find_program("c++").empty())
+        {
+            REQUIRE(fs::exists(cache_dir / "compiler_paths.json"));
+        }
+
+        xcpp::compiler_paths cached = xcpp::detect_compiler_paths(cache_dir.string());
+        REQUIRE(cached.resource_dir == detected.resource_dir);
+        REQUIRE(cached.system_includes == detected.system_includes);
+
+        fs::remove_all(cache_dir);
+    }
+
+    TEST_CASE("resource_dir_given"){
+        namespace fs = std::filesystem;
+        fs::path cache_dir = fs::temp_directory_path() / "xcompiler_paths_given_test";
+        fs::remove_all(cache_dir);
+
+        // Not detected when the user passes -resource-dir.
+        xcpp::compiler_paths given = xcpp::detect_compiler_paths(cache_dir.string(), false, false);
+        REQUIRE(given.resource_dir.empty());
+
+        // An entry without it is not used when it is needed.
+        xcpp::compiler_paths detected = xcpp::detect_compiler_paths(cache_dir.string());
+        xcpp::compiler_paths fresh = xcpp::detect_compiler_paths(cache_dir.string(), true);
+        REQUIRE(detected.resource_dir == fresh.resource_dir);
+        REQUIRE(detected.system_includes == given.system_includes);
+
+        fs::remove_all(cache_dir);
+    }
+}
+#endif
+
+#if defined(__linux__) && !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
+// Runs `f` in a child process, where the signal handlers of the kernel can be
+// installed, and returns its exit status.
+static int run_in_child(const std::function<int()>& f)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        std::_Exit(f());
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+TEST_SUITE("xinterrupt"){
+    TEST_CASE("interrupts_jit_code_only"){
+        int status = run_in_child(
+            []()
+            {
+                xcpp::install_interrupt_handler();
+                std::vector<const char*> Args = {};
+                xcpp::interpreter interpreter((int)Args.size(), Args.data());
+
+                // Library code is not abandoned: the interrupt waits for it.
+                int sig = xcpp::run_interruptible(
+                    []()
+                    {
+                        raise(SIGINT);
+                        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    }
+                );
+                if (sig != 0)
+                {
+                    return 1;
+                }
+
+                // The shield of another thread, e.g. one forwarding the
+                // output, does not defer the interrupt of the cell.
+                std::atomic<bool> finished(false);
+                std::thread interrupter(
+                    [&finished]()
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                        xcpp::xinterrupt_shield shield;
+                        kill(getpid(), SIGINT);
+                        auto start = std::chrono::steady_clock::now();
+                        while (!finished && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+                        {
+                            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                        }
+                    }
+                );
+                bool interrupted = false;
+                auto start = std::chrono::steady_clock::now();
+                try
+                {
+                    xcpp::process_cell("{ volatile unsigned long xcpp_spin = 0; while (true) ++xcpp_spin; }");
+                }
+                catch (const std::runtime_error& e)
+                {
+                    interrupted = std::string(e.what()).find("interrupted") != std::string::npos;
+                }
+                finished = true;
+                interrupter.join();
+                if (!interrupted || std::chrono::steady_clock::now() - start > std::chrono::seconds(3))
+                {
+                    return 2;
+                }
+
+                // The session survives.
+                try
+                {
+                    xcpp::process_cell("int xcpp_after_interrupt = 1;");
+                }
+                catch (const std::exception&)
+                {
+                    return 3;
+                }
+                return 0;
+            }
+        );
+        REQUIRE(status == 0);
+    }
+
+    TEST_CASE("recovers_from_jit_faults_only"){
+        int status = run_in_child(
+            []()
+            {
+                xcpp::install_crash_handler();
+                std::vector<const char*> Args = {};
+                xcpp::interpreter interpreter((int)Args.size(), Args.data());
+
+                bool aborted = false;
+                try
+                {
+                    xcpp::process_cell("int* xcpp_null_pointer = nullptr; *xcpp_null_pointer = 1;");
+                }
+                catch (const std::runtime_error& e)
+                {
+                    aborted = std::string(e.what()).find(std::to_string(SIGSEGV)) != std::string::npos;
+                }
+                if (!aborted)
+                {
+                    return 1;
+                }
+                try
+                {
+                    xcpp::process_cell("int xcpp_after_fault = 1;");
+                }
+                catch (const std::exception&)
+                {
+                    return 2;
+                }
+                return 0;
+            }
+        );
+        REQUIRE(status == 0);
+
+        // A fault in a library is not recovered from, the process is killed.
+        status = run_in_child(
+            []()
+            {
+                // Not reported by the handler of the test framework.
+                signal(SIGSEGV, SIG_DFL);
+                xcpp::install_crash_handler();
+                std::vector<const char*> Args = {};
+                xcpp::interpreter interpreter((int)Args.size(), Args.data());
+                try
+                {
+                    xcpp::process_cell("#include <cstring>\nstd::strlen(reinterpret_cast<const char*>(16));");
+                }
+                catch (const std::exception&)
+                {
+                }
+                return 0;
+            }
+        );
+        REQUIRE(status == 128 + SIGSEGV);
+
+        // Shields held by other threads, e.g. the ones forwarding the
+        // output, do not prevent the recovery.
+        status = run_in_child(
+            []()
+            {
+                xcpp::install_crash_handler();
+                std::vector<const char*> Args = {};
+                xcpp::interpreter interpreter((int)Args.size(), Args.data());
+                std::promise<void> shielded;
+                std::promise<void> done;
+                std::thread holder(
+                    [&shielded, released = done.get_future()]()
+                    {
+                        xcpp::xinterrupt_shield shield;
+                        shielded.set_value();
+                        released.wait();
+                    }
+                );
+                shielded.get_future().wait();
+                int res = 1;
+                try
+                {
+                    xcpp::process_cell("int* xcpp_shielded_null = nullptr; *xcpp_shielded_null = 1;");
+                }
+                catch (const std::runtime_error&)
+                {
+                    res = 0;
+                }
+                done.set_value();
+                holder.join();
+                return res;
+            }
+        );
+        REQUIRE(status == 0);
+    }
+}
+
+TEST_SUITE("xzygote"){
+    TEST_CASE("forks_kernels"){
+        namespace fs = std::filesystem;
+        const std::string socket_path =
+            (fs::temp_directory_path() / ("xcpp-zygote-test-" + std::to_string(getpid()) + ".sock")).string();
+        fs::remove(socket_path);
+
+        // The zygote and the client run in their own processes, forked from
+        // this single thread.
+        pid_t zygote = fork();
+        if (zygote == 0)
+        {
+            std::vector<const char*> Args = {};
+            auto prototype = std::make_unique<xcpp::interpreter>((int)Args.size(), Args.data());
+            auto start = [](std::unique_ptr<xcpp::interpreter> kernel, const std::string& connection_file)
+            {
+                return kernel != nullptr && connection_file == "kernel.json" ? 7 : 1;
+            };
+            std::_Exit(xcpp::run_zygote(socket_path, std::move(prototype), start));
+        }
+        REQUIRE(zygote > 0);
+
+        pid_t client = fork();
+        if (client == 0)
+        {
+            int code = 1;
+            for (int i = 0; i < 600 && code != 7; ++i)
+            {
+                if (fs::exists(socket_path))
+                {
+                    code = xcpp::connect_zygote(socket_path, "kernel.json");
+                }
+                if (code != 7)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                }
+            }
+            std::_Exit(code);
+        }
+        int status = 0;
+        waitpid(client, &status, 0);
+        kill(zygote, SIGKILL);
+        waitpid(zygote, nullptr, 0);
+        fs::remove(socket_path);
+
+        REQUIRE(WIFEXITED(status));
+        REQUIRE(WEXITSTATUS(status) == 7);
+    }
+}
+#endif
+
 #if !defined(XEUS_CPP_EMSCRIPTEN_WASM_BUILD)
 TEST_SUITE("xassist"){
 